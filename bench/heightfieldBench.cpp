@@ -0,0 +1,124 @@
+//  heightfieldBench - ground height below random points from the
+//  Heightfield grid against the straight down ray through the face
+//  octree (one ray at a time and as packets), on a synthetic rolling
+//  terrain with one floating slab as an overhang.  Also reports how far
+//  the grid's answers are from the exact surface, and fails if the grid
+//  answers a point the ray disagrees with.  No openFrameworks:
+//
+//      g++ -O2 -std=c++11 -pthread -I../src heightfieldBench.cpp ../src/Heightfield.cpp
+//          ../src/OctreeCore.cpp ../src/MappedFile.cpp ../src/ThreadPool.cpp ../src/box.cc -o heightfieldBench
+//
+//  (one command line; an argument sets the grid cell size)  Exits 1 on
+//  a hit / miss mismatch or a grid height further from the ray's than
+//  the terrain rises across one cell.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Heightfield.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+	const int n = 150;
+	const float size = 60;
+	const int numPoints = 100000;
+	float cellSize = argc > 1 ? atof(argv[1]) : 0;
+
+	// n x n grid of vertices, two triangles per square
+	//
+	std::vector<Vector3> verts;
+	std::vector<int> indices;
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			float x = -size / 2 + size * i / n, z = -size / 2 + size * j / n;
+			verts.push_back(Vector3(x, 2 * sinf(x * 0.3f) * cosf(z * 0.2f) + 0.5f * sinf(x * 1.7f + z), z));
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+			int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// slab floating over x, z in [5, 10]: top faces up, bottom faces down
+	//
+	int base = verts.size();
+	for (int k = 0; k < 8; k++)
+		verts.push_back(Vector3((k & 1) ? 10 : 5, (k & 4) ? 6.5f : 6, (k & 2) ? 10 : 5));
+	int slab[12] = { 4, 6, 5, 5, 6, 7, 0, 1, 2, 1, 3, 2 };
+	for (int k = 0; k < 12; k++)
+		indices.push_back(base + slab[k]);
+
+	OctreeCore surface;
+	surface.bUseFaces = true;
+	surface.create(verts, indices, 12);
+	Heightfield ground;
+	double t0 = now();
+	ground.create(&surface, cellSize);
+	double t1 = now();
+	printf("grid %d x %d, cell %.3f, %d of %d cells use the octree, built in %.1f ms\n", ground.numX,
+		ground.numZ, ground.cell, ground.numFallback, (ground.numX - 1) * (ground.numZ - 1), (t1 - t0) * 1000);
+
+	std::vector<Vector3> points(numPoints);
+	std::vector<Ray> rays(numPoints);
+	for (int i = 0; i < numPoints; i++) {
+		points[i] = Vector3(frand(-29.9f, 29.9f), frand(3, 20), frand(-29.9f, 29.9f));
+		rays[i] = Ray(points[i], Vector3(0, -1, 0));
+	}
+
+	// accuracy against the exact down ray.  The terrain's slope stays
+	// under 2, so it rises less than 3 cells across a cell's diagonal and
+	// no grid answer can be further than that from the ray's; more means
+	// the grid missed an overhang.
+	//
+	double sumError = 0, maxError = 0;
+	double tolerance = 3 * ground.cell;
+	int fromGrid = 0, mismatched = 0, wrong = 0;
+	for (int i = 0; i < numPoints; i++) {
+		OctreeHit a, b;
+		float y;
+		bool ha = ground.groundHit(points[i], a);
+		bool hb = surface.closestHit(rays[i], b);
+		if (ha != hb) mismatched++;
+		if (!ha || !hb || !ground.height(points[i].x(), points[i].z(), y)) continue;
+		double e = fabs(a.point.y() - b.point.y());
+		sumError += e;
+		if (e > maxError) maxError = e;
+		if (e > tolerance) wrong++;
+		fromGrid++;
+	}
+	printf("%d points, %d from the grid: error mean %.4f max %.4f, %d over %.3f, %d hit/miss mismatches\n",
+		numPoints, fromGrid, fromGrid ? sumError / fromGrid : 0.0, maxError, wrong, tolerance, mismatched);
+
+	// cost per query
+	//
+	std::vector<OctreeHit> hits(numPoints);
+	t0 = now();
+	for (int r = 0; r < 10; r++)
+		ground.groundHits(points.data(), numPoints, hits.data());
+	t1 = now();
+	double grid = (t1 - t0) * 1e9 / (10.0 * numPoints);
+	t0 = now();
+	for (int i = 0; i < numPoints; i++)
+		surface.closestHit(rays[i], hits[i]);
+	t1 = now();
+	double single = (t1 - t0) * 1e9 / numPoints;
+	t0 = now();
+	surface.closestHits(rays, hits);
+	t1 = now();
+	double packets = (t1 - t0) * 1e9 / numPoints;
+	printf("ns/query: heightfield %.1f, octree ray %.1f, octree ray packets %.1f\n", grid, single, packets);
+	return mismatched == 0 && wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+//  instanceBench - particles packed per second into the instance buffer
+//  (packParticleInstances(), the CPU half of ParticleSystem::draw()) at
+//  10k, 100k and 1M particles, checked against the per particle color
+//  Particle::draw() computes.  No openFrameworks or GL needed:
+//
+//      g++ -O2 -I../src instanceBench.cpp ../src/ParticleKernels.cpp -o instanceBench
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "ParticleKernels.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ofMap(age, 0, lifespan, 255, 10) as used by Particle::draw()
+//
+static float rampRed(float age, float lifespan) {
+	return 255 + (age / lifespan) * (10 - 255);
+}
+
+int main(int argc, char **argv) {
+	int reps = argc > 1 ? atoi(argv[1]) : 20;
+	int sizes[3] = { 10000, 100000, 1000000 };
+
+	printf("%10s %16s %12s\n", "particles", "packed/s", "ms/frame");
+	for (int s = 0; s < 3; s++) {
+		int n = sizes[s];
+		float clock = 10000;     // ms
+
+		std::vector<float> soa[7];
+		for (int a = 0; a < 7; a++) soa[a].resize(n);
+		for (int i = 0; i < n; i++) {
+			soa[0][i] = frand(-10, 10);
+			soa[1][i] = frand(-10, 10);
+			soa[2][i] = frand(-10, 10);
+			soa[3][i] = frand(0.5, 5);                   // lifespan (sec)
+			soa[4][i] = frand(0.01, 0.1);                // radius
+			soa[5][i] = clock - frand(0, 1000) * soa[3][i];  // birthtime (ms)
+		}
+		ParticleSpan span;
+		span.posX = &soa[0][0]; span.posY = &soa[1][0]; span.posZ = &soa[2][0];
+		span.lifespan = &soa[3][0];
+		span.radius = &soa[4][0];
+		span.birthtime = &soa[5][0];
+		span.count = n;
+
+		std::vector<ParticleInstance> out(n);
+		double t0 = now();
+		for (int r = 0; r < reps; r++)
+			packParticleInstances(span, 0, n, clock, &out[0]);
+		double t1 = now();
+
+		// the packed color must match the per particle draw
+		//
+		float err = 0;
+		for (int i = 0; i < n; i++) {
+			float age = (clock - span.birthtime[i]) / 1000.0;
+			float d = rampRed(age, span.lifespan[i]) / 255 - out[i].r;
+			if (d < 0) d = -d;
+			if (d > err) err = d;
+		}
+
+		double rate = (double)n * reps / (t1 - t0);
+		printf("%10d %16.3g %12.3f   (max color diff %g)\n", n, rate, (t1 - t0) * 1000 / reps, err);
+	}
+	return 0;
+}
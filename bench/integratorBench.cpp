@@ -0,0 +1,103 @@
+//  integratorBench - accuracy against cost for the LanderSim integrators
+//  (Integrator.h).  A lander under gravity, a constant thrust and the
+//  default damping is flown for 10 sec at step sizes from 1/240 to 1
+//  sec and compared with the exact solution; the cost is the time per
+//  step on the Vector3 state.  The last table is the largest step each
+//  integrator can take and stay within 1 cm of the exact position
+//  (below about 1e-4 m the float state's round off dominates).
+//  No openFrameworks needed:
+//
+//      g++ -O2 -I../src integratorBench.cpp -o integratorBench
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "vector3.h"
+#include "Integrator.h"
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *names[4] = { "ExplicitEuler", "SemiImplicitEuler", "VelocityVerlet", "RungeKutta4" };
+static const float duration = 10;     // sec
+
+//  x' = v, v' = a - k v with constant a:
+//      v(t) = a/k + (v0 - a/k) e^-kt
+//      x(t) = x0 + a/k t + (v0 - a/k) (1 - e^-kt) / k
+//
+static double exact(double x0, double v0, double a, double k, double t) {
+	double vt = a / k;
+	return x0 + vt * t + (v0 - vt) * (1 - std::exp(-k * t)) / k;
+}
+
+//  fly for duration at step dt; returns the position error (m)
+//
+static double flightError(IntegratorType type, float dt, int *numSteps) {
+	Vector3 x(0, 20, -30), v(1, 0, -0.5);
+	Vector3 a(0.2f, -0.164f + 0.3f, 0.1f);     // moon gravity (lander scale) + thrust
+	float k = dragRate(0.99f, 1.0f / 60);
+	int n = (int)std::lround(duration / dt);
+	for (int i = 0; i < n; i++)
+		integrateMotion(type, x, v, a, k, dt);
+	*numSteps = n;
+
+	double t = n * (double)dt;
+	double ex = exact(0, 1, a.x(), k, t) - x.x();
+	double ey = exact(20, 0, a.y(), k, t) - x.y();
+	double ez = exact(-30, -0.5, a.z(), k, t) - x.z();
+	return std::sqrt(ex * ex + ey * ey + ez * ez);
+}
+
+static double nsPerStep(IntegratorType type) {
+	Vector3 x(0, 20, -30), v(1, 0, -0.5), a(0.2f, 0.136f, 0.1f);
+	float k = dragRate(0.99f, 1.0f / 60);
+	const int n = 10000000;
+	double t0 = now();
+	for (int i = 0; i < n; i++)
+		integrateMotion(type, x, v, a, k, 1.0f / 60);
+	double t1 = now();
+	volatile float sink = x.y();
+	(void)sink;
+	return (t1 - t0) * 1e9 / n;
+}
+
+int main() {
+	float steps[6] = { 1.0f / 240, 1.0f / 60, 1.0f / 15, 1.0f / 4, 1.0f / 2, 1.0f };
+
+	printf("position error (m) after %g sec\n", duration);
+	printf("%18s", "step (sec)");
+	for (int s = 0; s < 6; s++) printf(" %10.4f", steps[s]);
+	printf("\n");
+	for (int m = 0; m < 4; m++) {
+		printf("%18s", names[m]);
+		for (int s = 0; s < 6; s++) {
+			int n;
+			printf(" %10.2e", flightError((IntegratorType)m, steps[s], &n));
+		}
+		printf("\n");
+	}
+
+	// largest step (of 1 .. 1/3840 sec) within 1 cm, and its cost per
+	// simulated second
+	//
+	printf("\n%18s %10s %12s %12s\n", "", "ns/step", "step (1cm)", "us/sim sec");
+	for (int m = 0; m < 4; m++) {
+		double ns = nsPerStep((IntegratorType)m);
+		float best = 0;
+		for (int hz = 1; hz <= 3840; hz *= 2) {
+			int n;
+			if (flightError((IntegratorType)m, 1.0f / hz, &n) < 1e-2) {
+				best = 1.0f / hz;
+				break;
+			}
+		}
+		if (best > 0)
+			printf("%18s %10.2f %12.4f %12.3f\n", names[m], ns, best, ns / best / 1000);
+		else
+			printf("%18s %10.2f %12s %12s\n", names[m], ns, "-", "-");
+	}
+	return 0;
+}
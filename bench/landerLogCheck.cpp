@@ -0,0 +1,117 @@
+//  landerLogCheck - recorded sessions hold only what the pilot did.  Plays
+//  a scripted session the way the app records one (thrust and rotate
+//  inputs, pause / resume, mouse presses and releases through LanderDrag
+//  as ofApp's mouse handlers use it) on a rolling terrain, saves and
+//  reloads the log and replays it.  A session with clicks (on the lander
+//  and off it) but no drags must hold no move records; one with drags
+//  one per drag; both must replay to the recorded end.  No
+//  openFrameworks:
+//
+//      g++ -O2 -std=c++11 -pthread -I../src landerLogCheck.cpp
+//          ../src/{LanderLog,LanderSim,Heightfield,TerrainSdf,OctreeCore,MappedFile,ThreadPool}.cpp ../src/box.cc -o landerLogCheck
+//
+//  (one command line)  Exits 1 on any failure.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "LanderLog.h"
+
+static const float dt = 1.0 / 60;
+
+//  one session: every 30 ticks a pilot input; a click on the lander (press
+//  and release, no motion) every 45, a release with nothing picked (camera
+//  orbit or gui click) every 50, a pause / resume around tick 400 and,
+//  with drags, a drag of the lander every 120 ticks
+//
+static void record(const OctreeCore & terrain, const OctreeCore & surface, bool drags, LanderLog & session) {
+	LanderSim sim;
+	sim.bounds = Box(Vector3(-0.5f, 0, -0.5f), Vector3(0.5f, 1, 0.5f));
+	sim.startingPosition = Vector3(0, 8, 0);
+	sim.setTerrain(&terrain, &surface);
+	sim.reset(7);
+	session.begin(sim, dt, &terrain, &surface);
+	LanderDrag drag;
+	for (int frame = 0; frame < 900; frame++) {
+		if (frame % 30 == 0) {
+			LanderInput input = frame % 60 == 0 ? ThrustUp : RotateBack;
+			sim.apply(input);
+			session.input(sim, input);
+		}
+		if (frame % 45 == 0) {
+			drag.press(sim);
+			drag.drag(Vector3(0, 0, 0));
+			if (drag.release(sim)) session.move(sim);
+		}
+		if (frame % 50 == 0 && drag.release(sim)) session.move(sim);
+		if (drags && frame % 120 == 60) {
+			drag.press(sim);
+			drag.drag(Vector3(0.5f, 1, 0));
+			drag.drag(Vector3(-0.25f, 0.5f, 0.5f));
+			if (drag.release(sim)) session.move(sim);
+		}
+		if (frame == 400 || frame == 460) {
+			sim.running = !sim.running;
+			session.running(sim);
+		}
+		if (sim.running) sim.step(dt);
+	}
+	session.finish(sim);
+}
+
+static int countMoves(const LanderLog & log) {
+	int moves = 0;
+	for (size_t i = 0; i < log.entries.size(); i++)
+		if (log.entries[i].type == LogMove) moves++;
+	return moves;
+}
+
+int main() {
+	const int n = 40;
+	const float size = 40;
+
+	// n x n grid of vertices, two triangles per square
+	//
+	std::vector<Vector3> verts;
+	std::vector<int> indices;
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			float x = -size / 2 + size * i / n, z = -size / 2 + size * j / n;
+			verts.push_back(Vector3(x, 2 * sinf(x * 0.3f) * cosf(z * 0.2f), z));
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+			int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	OctreeCore terrain, surface;
+	terrain.create(verts, indices, 12);
+	surface.bUseFaces = true;
+	surface.create(verts, indices, 12);
+
+	bool ok = true;
+	const char *path = "landerLogCheck.landerlog";
+	for (int pass = 0; pass < 2; pass++) {
+		bool drags = pass == 1;
+		LanderLog session, loaded;
+		record(terrain, surface, drags, session);
+		int moves = countMoves(session);
+		int expected = drags ? 7 : 0;
+		bool saved = session.save(path) && loaded.load(path);
+		LanderSim sim;
+		sim.setTerrain(&terrain, &surface);
+		loaded.setup(sim);
+		loaded.replay(sim);
+		bool replayed = saved && loaded.matches(sim);
+		printf("%s: %d entries, %d move records (want %d), %s\n", drags ? "clicks and drags" : "clicks, no drags",
+			(int)session.entries.size(), moves, expected, replayed ? "replays to the recorded end" :
+			saved ? "replay differs" : "save / load failed");
+		if (moves != expected || !replayed) ok = false;
+	}
+	remove(path);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+//  landerTunnelCheck - the lander must not pass through the terrain.  A
+//  yawed lander starts resting on a rolling terrain and is driven into it
+//  (down thruster held, turning) at step sizes from 1/4 to 3 seconds, so
+//  each step moves it by more than its own size; an episode fails if the
+//  lander ever ends a step wholly below the surface.  Also checks one
+//  swept box against one triangle it already touches.  No openFrameworks:
+//
+//      g++ -O2 -std=c++11 -pthread -I../src landerTunnelCheck.cpp
+//          ../src/{LanderSim,Heightfield,TerrainSdf,OctreeCore,MappedFile,ThreadPool}.cpp ../src/box.cc -o landerTunnelCheck
+//
+//  (one command line; an argument sets the episodes per step size)
+//  Exits 1 on any pass through.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "LanderSim.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+int main(int argc, char **argv) {
+	const int n = 80;
+	const float size = 80;
+	const int steps = 200;
+	const float side = 0.6f;
+	int episodes = argc > 1 ? atoi(argv[1]) : 50;
+
+	// a box just touching a triangle from above (as a contact push out
+	// leaves it), moved down through it
+	//
+	Vector3 a(-2, 0, -2), b(-2, 0, 2), c(2, 0, 0);
+	Box touching(Vector3(-side / 2, -0.01f, -side / 2), Vector3(side / 2, side - 0.01f, side / 2));
+	float t = -1;
+	Vector3 normal;
+	bool caught = touching.sweep(Vector3(0, -5, 0), a, b, c, t, normal);
+	printf("%g box touching a triangle, moved 5 down: %s (t %g, normal %g %g %g)\n", side,
+		caught ? "stopped" : "missed", t, normal.x(), normal.y(), normal.z());
+	bool ok = caught && t == 0 && normal.y() > 0.99f;
+
+	// n x n grid of vertices, two triangles per square
+	//
+	std::vector<Vector3> verts;
+	std::vector<int> indices;
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			float x = -size / 2 + size * i / n, z = -size / 2 + size * j / n;
+			verts.push_back(Vector3(x, 2 * sinf(x * 0.3f) * cosf(z * 0.2f), z));
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+			int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	OctreeCore terrain, surface;
+	terrain.create(verts, indices, 12);
+	surface.bUseFaces = true;
+	surface.create(verts, indices, 12);
+	Heightfield ground;
+	ground.create(&surface);
+
+	// lander resting on the surface at a random place and yaw, driven down
+	//
+	float dts[3] = { 0.25f, 1, 3 };
+	for (int k = 0; k < 3; k++) {
+		int through = 0;
+		srand(1);
+		for (int e = 0; e < episodes; e++) {
+			LanderSim sim;
+			sim.bounds = Box(Vector3(-side / 2, 0, -side / 2), Vector3(side / 2, side, side / 2));
+			sim.integrator = ExplicitEuler;
+			sim.winCon = 1e9;
+			sim.startFuel = 1 << 30;
+			sim.setTerrain(&terrain, &surface, &ground);
+			sim.reset(e + 1);
+			float x = frand(-30, 30), z = frand(-30, 30);
+			sim.position = Vector3(x, 0, z);
+			sim.rotation = sim.previousRotation = frand(0, 360);
+			Box box = sim.worldObb().bounds();
+			sim.position = Vector3(x, ground.top(box.min().x(), box.min().z(), box.max().x(), box.max().z()), z);
+			for (int i = 0; i < steps; i++) {
+				sim.apply(ThrustDown);
+				sim.apply(RotateBack);
+				sim.step(dts[k]);
+				float y;
+				Vector3 p = sim.position;
+				if (fabsf(p.x()) > size / 2 - 2 || fabsf(p.z()) > size / 2 - 2 || !ground.height(p.x(), p.z(), y))
+					break;
+				if (p.y() + side < y) {
+					through++;
+					break;
+				}
+			}
+		}
+		printf("dt %.2f: %d of %d episodes passed through the terrain\n", dts[k], through, episodes);
+		if (through > 0) ok = false;
+	}
+	return ok ? 0 : 1;
+}
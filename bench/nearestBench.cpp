@@ -0,0 +1,181 @@
+//  nearestBench - k nearest, fixed radius and pick cone point queries on
+//  the octree against a scan of every point, on a rolling terrain sampled
+//  at 200k random points.  The tree is a MortonBuild, as the point queries want
+//  (see OctreeCore::nearest()).  Checks that both give the same answers,
+//  and that the pick cone (with its slope set as ofApp::doPointSelection()
+//  sets it) holds every point the app's screen test would take, for mouse
+//  points anywhere on a 60 and a 120 degree view.  Exits 1 if not.  No
+//  openFrameworks:
+//
+//      g++ -O2 -std=c++11 -pthread -I../src nearestBench.cpp ../src/OctreeCore.cpp
+//          ../src/MappedFile.cpp ../src/ThreadPool.cpp ../src/box.cc -o nearestBench
+//
+//  (one command line; arguments set k and the radius)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "OctreeCore.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+	const int numPoints = 200000;
+	const int numQueries = 2000;
+	int k = argc > 1 ? atoi(argv[1]) : 8;
+	float radius = argc > 2 ? atof(argv[2]) : 1;
+
+	std::vector<Vector3> points(numPoints);
+	for (int i = 0; i < numPoints; i++) {
+		float x = frand(-50, 50), z = frand(-50, 50);
+		points[i] = Vector3(x, 2 * sinf(x * 0.3f) * cosf(z * 0.2f), z);
+	}
+	std::vector<Vector3> queries(numQueries);
+	for (int i = 0; i < numQueries; i++)
+		queries[i] = Vector3(frand(-50, 50), frand(-1, 3), frand(-50, 50));
+
+	// pick rays: from an eye above the terrain toward a point on it, with
+	// a cone about 10 pixels wide on a 1000 pixel high, 60 degree view
+	//
+	const float slope = 10 * 2 * tanf(3.14159265f / 6) / 1000;
+	std::vector<Ray> rays(numQueries);
+	for (int i = 0; i < numQueries; i++) {
+		Vector3 eye(frand(-60, 60), frand(10, 40), frand(-60, 60));
+		Vector3 dir = Vector3(frand(-50, 50), 0, frand(-50, 50)) - eye;
+		dir.normalize();
+		rays[i] = Ray(eye, dir);
+	}
+
+	OctreeCore tree;
+	tree.buildType = MortonBuild;
+	double t0 = now();
+	tree.create(points, std::vector<int>(), 20);
+	double t1 = now();
+	printf("%d points, %d nodes, built in %.0f ms\n", numPoints, tree.numNodes, (t1 - t0) * 1000);
+
+	// scan: distance to every point, partially sorted
+	//
+	std::vector<std::vector<float> > knnScan(numQueries), radiusScan(numQueries);
+	std::vector<float> d(numPoints);
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		for (int i = 0; i < numPoints; i++)
+			d[i] = (points[i] - queries[q]) * (points[i] - queries[q]);
+		std::partial_sort(d.begin(), d.begin() + k, d.end());
+		knnScan[q].assign(d.begin(), d.begin() + k);
+	}
+	t1 = now();
+	double knnLinear = (t1 - t0) * 1e6 / numQueries;
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		for (int i = 0; i < numPoints; i++) {
+			float d2 = (points[i] - queries[q]) * (points[i] - queries[q]);
+			if (d2 <= radius * radius) radiusScan[q].push_back(d2);
+		}
+	}
+	t1 = now();
+	double radiusLinear = (t1 - t0) * 1e6 / numQueries;
+	std::vector<int> coneScan(numQueries, 0);
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		for (int i = 0; i < numPoints; i++) {
+			Vector3 w = points[i] - rays[q].origin;
+			float t = w * rays[q].direction;
+			Vector3 off = w - rays[q].direction * t;
+			if (t >= 0 && off * off <= slope * slope * t * t) coneScan[q]++;
+		}
+	}
+	t1 = now();
+	double coneLinear = (t1 - t0) * 1e6 / numQueries;
+
+	// octree
+	//
+	std::vector<OctreeNeighbor> result;
+	int mismatched = 0, found = 0;
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		tree.nearest(queries[q], k, result);
+		for (int i = 0; i < k; i++)
+			if (i >= (int)result.size() || fabsf(result[i].distance - sqrtf(knnScan[q][i])) > 1e-4f) mismatched++;
+	}
+	t1 = now();
+	double knnTree = (t1 - t0) * 1e6 / numQueries;
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		found += tree.withinRadius(queries[q], radius, result);
+		if (result.size() != radiusScan[q].size()) mismatched++;
+	}
+	t1 = now();
+	double radiusTree = (t1 - t0) * 1e6 / numQueries;
+	int inCone = 0;
+	t0 = now();
+	for (int q = 0; q < numQueries; q++) {
+		inCone += tree.withinCone(rays[q], slope, result);
+		if ((int)result.size() != coneScan[q]) mismatched++;
+	}
+	t1 = now();
+	double coneTree = (t1 - t0) * 1e6 / numQueries;
+
+	// screen picks: a camera above the terrain looking at a point on it,
+	// the mouse anywhere on a 1600 x 1000 view.  Every point in front of
+	// the eye that projects within range pixels of the mouse must be in
+	// the cone around the mouse ray, its slope range pixels at depth 1 on
+	// the view axis, times the cosine of the ray's angle to the axis, times
+	// the 1.5 margin.
+	//
+	const int numCameras = 200;
+	const float width = 1600, height = 1000, range = 10;
+	float fovs[2] = { 60, 120 };
+	int missed = 0;
+	std::vector<char> picked(numPoints);
+	for (int v = 0; v < 2; v++) {
+		float focal = height / 2 / tanf(fovs[v] * 3.14159265f / 360);
+		int numPicks = 0, numCandidates = 0;
+		for (int c = 0; c < numCameras; c++) {
+			Vector3 eye(frand(-60, 60), frand(10, 40), frand(-60, 60));
+			Vector3 forward = Vector3(frand(-30, 30), 0, frand(-30, 30)) - eye;
+			forward.normalize();
+			Vector3 right = forward ^ Vector3(0, 1, 0);
+			right.normalize();
+			Vector3 up = right ^ forward;
+			float mx = frand(0, width), my = frand(0, height);
+			Vector3 dir = forward + right * ((mx - width / 2) / focal) - up * ((my - height / 2) / focal);
+			dir.normalize();
+			float coneSlope = 1.5f * range / focal * (dir * forward);
+			tree.withinCone(Ray(eye, dir), coneSlope, result);
+			numCandidates += result.size();
+			std::fill(picked.begin(), picked.end(), 0);
+			for (size_t i = 0; i < result.size(); i++)
+				picked[result[i].index] = 1;
+			for (int i = 0; i < numPoints; i++) {
+				Vector3 w = points[i] - eye;
+				float z = w * forward;
+				if (z <= 0) continue;
+				float dx = width / 2 + focal * (w * right) / z - mx;
+				float dy = height / 2 - focal * (w * up) / z - my;
+				if (dx * dx + dy * dy >= range * range) continue;
+				numPicks++;
+				if (!picked[i]) missed++;
+			}
+		}
+		printf("%.0f degree view: %d points within %.0f pixels of the mouse, %d in the pick cones\n", fovs[v],
+			numPicks, range, numCandidates);
+	}
+
+	printf("us/query: %d nearest: scan %.1f, octree %.2f; radius %.2f (%.1f points): scan %.1f, octree %.2f\n", k,
+		knnLinear, knnTree, radius, found / (double)numQueries, radiusLinear, radiusTree);
+	printf("us/query: pick cone (%.1f points): scan %.1f, octree %.2f\n", inCone / (double)numQueries, coneLinear,
+		coneTree);
+	printf("%d mismatches, %d screen picks outside the pick cone\n", mismatched, missed);
+	return mismatched == 0 && missed == 0 ? 0 : 1;
+}
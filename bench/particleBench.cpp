@@ -0,0 +1,122 @@
+//  particleBench - particles integrated per second: the per-particle loop
+//  (Particle::integrate on an array of structs, one frame rate call per
+//  particle) against the batch integrateParticles() kernel on a structure
+//  of arrays, at 10k, 100k and 1M particles.  No openFrameworks needed:
+//
+//      g++ -O2 -mavx2 -I../src particleBench.cpp ../src/ParticleKernels.cpp -o particleBench
+//
+//  (drop -mavx2 for the SSE path, add -mno-sse2 -mno-avx on x86 for scalar)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "ParticleKernels.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// stand-ins for ofVec3f / Particle / ofGetFrameRate() with the same layout
+// and the same per-particle work as Particle::integrate()
+//
+struct Vec3 {
+	float x, y, z;
+	Vec3 operator+(const Vec3 &v) const { Vec3 r = { x + v.x, y + v.y, z + v.z }; return r; }
+	Vec3 operator*(float s) const { Vec3 r = { x * s, y * s, z * s }; return r; }
+	Vec3 operator/(float s) const { Vec3 r = { x / s, y / s, z / s }; return r; }
+	Vec3 & operator+=(const Vec3 &v) { x += v.x; y += v.y; z += v.z; return *this; }
+	Vec3 & operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+};
+
+struct Color { unsigned char r, g, b, a; };
+
+struct Particle {
+	Vec3 position, velocity, acceleration, forces;
+	float damping, mass, lifespan, radius, birthtime;
+	Color color;
+};
+
+__attribute__((noinline)) static float frameRate() {
+	return 60;
+}
+
+static void integrateAoS(Particle &p) {
+	float dt = 1.0 / frameRate();
+	p.position += (p.velocity * dt);
+	Vec3 accel = p.acceleration;
+	accel += (p.forces * (1.0 / p.mass));
+	p.velocity += accel * dt;
+	p.velocity *= p.damping;
+	p.forces = Vec3{ 0, 0, 0 };
+}
+
+int main(int argc, char **argv) {
+	int reps = argc > 1 ? atoi(argv[1]) : 20;
+	int sizes[3] = { 10000, 100000, 1000000 };
+
+	printf("%10s %16s %16s %8s\n", "particles", "per-particle/s", "batch/s", "speedup");
+	for (int s = 0; s < 3; s++) {
+		int n = sizes[s];
+
+		std::vector<Particle> aos(n);
+		std::vector<float> soa[14];
+		for (int a = 0; a < 14; a++) soa[a].resize(n);
+		for (int i = 0; i < n; i++) {
+			Particle &p = aos[i];
+			p.position = Vec3{ frand(-10, 10), frand(-10, 10), frand(-10, 10) };
+			p.velocity = Vec3{ frand(-1, 1), frand(-1, 1), frand(-1, 1) };
+			p.acceleration = Vec3{ 0, 0, 0 };
+			p.forces = Vec3{ 0, -9.8f, 0 };
+			p.damping = .99;
+			p.mass = frand(0.5, 2);
+			float v[14] = { p.position.x, p.position.y, p.position.z,
+				p.velocity.x, p.velocity.y, p.velocity.z, 0, 0, 0,
+				p.forces.x, p.forces.y, p.forces.z, p.damping, p.mass };
+			for (int a = 0; a < 14; a++) soa[a][i] = v[a];
+		}
+		ParticleSpan span;
+		span.posX = &soa[0][0]; span.posY = &soa[1][0]; span.posZ = &soa[2][0];
+		span.velX = &soa[3][0]; span.velY = &soa[4][0]; span.velZ = &soa[5][0];
+		span.accX = &soa[6][0]; span.accY = &soa[7][0]; span.accZ = &soa[8][0];
+		span.forceX = &soa[9][0]; span.forceY = &soa[10][0]; span.forceZ = &soa[11][0];
+		span.damping = &soa[12][0];
+		span.mass = &soa[13][0];
+		span.count = n;
+
+		// keep the work comparable: re-add the force every step in both
+		//
+		double t0 = now();
+		for (int r = 0; r < reps; r++) {
+			for (int i = 0; i < n; i++) {
+				aos[i].forces.y = -9.8f;
+				integrateAoS(aos[i]);
+			}
+		}
+		double t1 = now();
+		for (int r = 0; r < reps; r++) {
+			for (int i = 0; i < n; i++) span.forceY[i] = -9.8f;
+			integrateParticles(span, 0, n, 1.0f / 60);
+		}
+		double t2 = now();
+
+		// both versions must agree
+		//
+		float err = 0;
+		for (int i = 0; i < n; i++) {
+			float d = aos[i].position.y - span.posY[i];
+			if (d < 0) d = -d;
+			if (d > err) err = d;
+		}
+
+		double aosRate = (double)n * reps / (t1 - t0);
+		double soaRate = (double)n * reps / (t2 - t1);
+		printf("%10d %16.3g %16.3g %7.1fx   (max diff %g)\n", n, aosRate, soaRate, soaRate / aosRate, err);
+	}
+	return 0;
+}
@@ -0,0 +1,146 @@
+//  particlePoolBench - the fixed capacity particle pool.  Runs a steady
+//  emit / update loop with the pool full (every add replaces the oldest
+//  particle) and fails if any of it touches the heap, counted with a
+//  global operator new: once at the app's capacity, which fits in one
+//  update chunk, and once in parallel at 10000, where every frame submits
+//  a ThreadPool task per chunk.  The shared pool has no workers on a one
+//  core machine, so the same chunk submits are also run on a pool of two
+//  workers.  Then times one DropOldest add at several pool sizes (the
+//  replacement should not depend on the size) and checks the replaced
+//  particle is the oldest.
+//
+//  Unlike the other benches this one needs openFrameworks (ParticleSystem
+//  works on ofVec3f / ofColor): build it as a command line openFrameworks
+//  project with ParticleSystem.cpp, Particle.cpp, ParticleKernels.cpp,
+//  ParticleRenderer.cpp, OctreeCore.cpp, MappedFile.cpp, ThreadPool.cpp
+//  and box.cc from ../src.  Exits 1 if a loop allocated.
+//
+//      ./particlePoolBench [capacity] [groupSize]      (2000 and 50, as the app)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "ParticleSystem.h"
+
+static std::atomic<long> numNews(0);
+
+void *operator new(std::size_t n) {
+	numNews++;
+	void *p = malloc(n ? n : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static float birth = 0;
+
+static Particle spawn() {
+	Particle p;
+	p.position.set(frand(-1, 1), frand(-1, 1), frand(-1, 1));
+	p.velocity.set(frand(-1, 1), frand(0, 5), frand(-1, 1));
+	p.lifespan = -1;
+	p.birthtime = birth++;
+	return p;
+}
+
+//  frames of a steady emit / update loop, starting with the pool full;
+//  returns the heap allocations after the warmup
+//
+static long steady(int capacity, int groupSize, bool parallel, int warmup, int frames) {
+	ParticleSystem sys;
+	sys.bParallel = parallel;
+	sys.setCapacity(capacity, DropOldest);
+	sys.addForce(new GravityForce(ofVec3f(0, -1.64, 0)));
+	sys.addForce(new TurbulenceForce(ofVec3f(-1, -1, -1), ofVec3f(1, 1, 1)));
+	for (int i = 0; i < capacity; i++)
+		sys.add(spawn());
+	for (int f = 0; f < warmup + frames; f++) {
+		if (f == warmup) numNews = 0;
+		for (int i = 0; i < groupSize; i++)
+			sys.add(spawn());
+		sys.update(1.0 / 60);
+	}
+	long news = numNews;
+	printf("%d frames of %d adds at capacity %d%s: %ld heap allocations, %d pool growths, %d dropped\n",
+		frames, groupSize, capacity, parallel ? " in parallel" : "", news, sys.particles.allocations, sys.dropped);
+	return news;
+}
+
+int main(int argc, char **argv) {
+	int capacity = argc > 1 ? atoi(argv[1]) : 2000;
+	int groupSize = argc > 2 ? atoi(argv[2]) : 50;
+	const int warmup = 60, frames = 250;
+
+	// steady loops at capacity, in one chunk and over several
+	//
+	long news = steady(capacity, groupSize, false, warmup, frames);
+	news += steady(10000, groupSize, true, warmup, frames);
+
+	// the update's chunk submits (one task per chunk, capturing the chunk
+	// function and the chunk index) on a pool that has workers
+	//
+	ThreadPool pool(2);
+	std::atomic<long> sum(0);
+	auto runChunk = [&sum](int c) { sum += c; };
+	int numChunks = 200000 / 4096 + 1;
+	for (int f = 0; f < warmup + frames; f++) {
+		if (f == warmup) numNews = 0;
+		TaskGroup group;
+		for (int c = 0; c < numChunks; c++)
+			pool.submit(group, [&runChunk, c] { runChunk(c); });
+		pool.wait(group);
+	}
+	long submitNews = numNews;
+	printf("%d frames of %d chunk tasks on %d workers: %ld heap allocations\n",
+		frames, numChunks, pool.size(), submitNews);
+	news += submitNews;
+
+	// cost of one DropOldest add against the pool size, then a check that
+	// the particle each add replaces is the oldest, with the slots
+	// shuffled now and then as lifespan removals do
+	//
+	int sizes[3] = { 2000, 20000, 200000 };
+	const int adds = 100000;
+	std::vector<Particle> spawned(adds);
+	int wrong = 0;
+	for (int s = 0; s < 3; s++) {
+		ParticleSystem pool;
+		pool.setCapacity(sizes[s], DropOldest);
+		for (int i = 0; i < sizes[s]; i++)
+			pool.add(spawn());
+		for (int i = 0; i < adds; i++)
+			spawned[i] = spawn();
+		double t0 = now();
+		for (int i = 0; i < adds; i++)
+			pool.add(spawned[i]);
+		double t1 = now();
+		printf("capacity %6d: %.1f ns per add at capacity\n", sizes[s], (t1 - t0) * 1e9 / adds);
+
+		for (int i = 0; i < 100; i++) {
+			pool.remove(rand() % pool.particles.size());
+			pool.add(spawn());
+			int oldest = 0;
+			for (int j = 1; j < pool.particles.size(); j++)
+				if (pool.particles.birthtime[j] < pool.particles.birthtime[oldest]) oldest = j;
+			if (pool.particles.oldest() != oldest) wrong++;
+			pool.add(spawn());
+		}
+	}
+	printf("%d times the replaced particle was not the oldest\n", wrong);
+	return news == 0 && wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+//  rayBoxBench - compares the scalar Box::intersect() with the batched
+//  intersect8() kernels (one ray vs. an 8 box child block, and an 8 ray
+//  packet vs. one box).  Only needs the geometry sources, no openFrameworks:
+//
+//      g++ -O2 -mavx2 -I../src rayBoxBench.cpp ../src/box.cc -o rayBoxBench
+//
+//  (drop -mavx2 for the SSE path, add -mno-sse2 -mno-avx on x86 for scalar)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "box.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+	const int numBlocks = 4096;
+	const int numRays = 4096;
+	int reps = argc > 1 ? atoi(argv[1]) : 20;
+
+	// random child blocks (octants of a random parent) and random rays
+	//
+	std::vector<Box> boxes(numBlocks * 8);
+	std::vector<Box8> blocks(numBlocks);
+	for (int i = 0; i < numBlocks; i++) {
+		Vector3 min(frand(-50, 40), frand(-10, 0), frand(-50, 40));
+		float s = frand(1, 10) / 2;
+		for (int j = 0; j < 8; j++) {
+			Vector3 c = min + Vector3((j & 1) * s, ((j >> 2) & 1) * s, ((j >> 1) & 1) * s);
+			boxes[i * 8 + j] = Box(c, c + Vector3(s, s, s));
+			blocks[i].set(j, boxes[i * 8 + j]);
+		}
+	}
+	std::vector<Ray> rays(numRays);
+	for (int i = 0; i < numRays; i++) {
+		Vector3 d(frand(-1, 1), -1, frand(-1, 1));
+		d.normalize();
+		rays[i] = Ray(Vector3(frand(-50, 50), 20, frand(-50, 50)), d);
+	}
+	std::vector<Ray8> packets(numRays / 8);
+	for (int i = 0; i < numRays; i++)
+		packets[i / 8].set(i % 8, rays[i]);
+
+	// one ray vs. 8 boxes
+	//
+	long hitsScalar = 0, hitsBatch = 0;
+	double t = now();
+	for (int r = 0; r < reps; r++)
+		for (int i = 0; i < numRays; i++)
+			for (int b = 0; b < numBlocks; b += 64)
+				for (int j = 0; j < 8; j++)
+					hitsScalar += boxes[b * 8 + j].intersect(rays[i], 0, 1000);
+	double scalarTime = now() - t;
+
+	t = now();
+	float tNear[8];
+	for (int r = 0; r < reps; r++)
+		for (int i = 0; i < numRays; i++)
+			for (int b = 0; b < numBlocks; b += 64)
+				hitsBatch += __builtin_popcount(intersect8(rays[i], blocks[b], 0, 1000, tNear));
+	double batchTime = now() - t;
+
+	double tests = (double)reps * numRays * (numBlocks / 64) * 8;
+	printf("ray vs 8 boxes:   scalar %6.1f Mtests/s   batch %6.1f Mtests/s   (x%.2f)  hits %ld / %ld\n",
+		tests / scalarTime / 1e6, tests / batchTime / 1e6, scalarTime / batchTime, hitsScalar, hitsBatch);
+
+	// 8 ray packet vs. one box
+	//
+	hitsScalar = hitsBatch = 0;
+	t = now();
+	for (int r = 0; r < reps; r++)
+		for (int b = 0; b < numBlocks * 8; b += 64)
+			for (int i = 0; i < numRays; i++)
+				hitsScalar += boxes[b].intersect(rays[i], 0, 1000);
+	scalarTime = now() - t;
+
+	float t1[8] = { 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000 };
+	t = now();
+	for (int r = 0; r < reps; r++)
+		for (int b = 0; b < numBlocks * 8; b += 64)
+			for (size_t p = 0; p < packets.size(); p++)
+				hitsBatch += __builtin_popcount(intersect8(packets[p], boxes[b], 0, t1, tNear));
+	batchTime = now() - t;
+
+	tests = (double)reps * (numBlocks * 8 / 64) * numRays;
+	printf("8 rays vs box:    scalar %6.1f Mtests/s   batch %6.1f Mtests/s   (x%.2f)  hits %ld / %ld\n",
+		tests / scalarTime / 1e6, tests / batchTime / 1e6, scalarTime / batchTime, hitsScalar, hitsBatch);
+	return 0;
+}
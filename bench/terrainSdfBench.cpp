@@ -0,0 +1,137 @@
+//  terrainSdfBench - TerrainSdf on a synthetic rolling terrain: build and
+//  cached reload time, memory, the error of its distances against the
+//  exact distance to the mesh (every triangle tried) near the surface, and
+//  the cost of a lookup.  No openFrameworks:
+//
+//      g++ -O2 -std=c++11 -pthread -I../src terrainSdfBench.cpp ../src/TerrainSdf.cpp ../src/Heightfield.cpp
+//          ../src/OctreeCore.cpp ../src/MappedFile.cpp ../src/ThreadPool.cpp ../src/box.cc -o terrainSdfBench
+//
+//  (one command line; an argument sets the grid cell size)
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "TerrainSdf.h"
+#include "Heightfield.h"
+
+static float frand(float a, float b) {
+	return a + (b - a) * (rand() / (float)RAND_MAX);
+}
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static float segmentDistance2(const Vector3 &p, const Vector3 &a, const Vector3 &b) {
+	Vector3 ab = b - a;
+	float t = fmaxf(0, fminf(1, ((p - a) * ab) / (ab * ab)));
+	Vector3 d = p - (a + ab * t);
+	return d * d;
+}
+
+static float triangleDistance(const Vector3 &p, const Vector3 &a, const Vector3 &b, const Vector3 &c) {
+	Vector3 n = (b - a) ^ (c - a);
+	n.normalize();
+	float h = (p - a) * n;
+	Vector3 q = p - n * h;
+	if ((((b - a) ^ (q - a)) * n) >= 0 && (((c - b) ^ (q - b)) * n) >= 0 && (((a - c) ^ (q - c)) * n) >= 0)
+		return fabsf(h);
+	return sqrtf(fminf(segmentDistance2(p, a, b), fminf(segmentDistance2(p, b, c), segmentDistance2(p, c, a))));
+}
+
+int main(int argc, char **argv) {
+	const int n = 150;
+	const float size = 60;
+	const int numChecked = 2000;
+	const int numPoints = 1000000;
+	const char *cachePath = "terrainSdfBench.sdf";
+	float cellSize = argc > 1 ? atof(argv[1]) : 0;
+
+	// n x n grid of vertices, two triangles per square
+	//
+	std::vector<Vector3> verts;
+	std::vector<int> indices;
+	for (int j = 0; j <= n; j++) {
+		for (int i = 0; i <= n; i++) {
+			float x = -size / 2 + size * i / n, z = -size / 2 + size * j / n;
+			verts.push_back(Vector3(x, 2 * sinf(x * 0.3f) * cosf(z * 0.2f) + 0.5f * sinf(x * 1.7f + z), z));
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int i = 0; i < n; i++) {
+			int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+			int quad[6] = { a, c, b, b, c, d };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	OctreeCore surface;
+	surface.bUseFaces = true;
+	surface.create(verts, indices, 12);
+	remove(cachePath);
+	TerrainSdf field;
+	double t0 = now();
+	field.createCached(&surface, cachePath, cellSize);
+	double t1 = now();
+	printf("cell %.3f, band %.3f, %d x %d x %d bricks, %d stored (%.1f MB), built in %.0f ms\n", field.cell,
+		field.band, field.bricksX, field.bricksY, field.bricksZ, field.numBricks,
+		field.numBricks * TerrainSdf::brickSamples * sizeof(float) / 1e6, (t1 - t0) * 1000);
+	TerrainSdf cached;
+	t0 = now();
+	bool reloaded = cached.createCached(&surface, cachePath, cellSize);
+	t1 = now();
+	printf("cache %s in %.2f ms\n", reloaded ? "mapped" : "rebuilt", (t1 - t0) * 1000);
+
+	// accuracy near the surface: the sign from the height below, the
+	// distance from every triangle
+	//
+	Heightfield ground;
+	ground.create(&surface);
+	double sumError = 0, maxError = 0;
+	int checked = 0, wrongSign = 0, differs = 0;
+	for (int i = 0; i < numChecked; i++) {
+		float x = frand(-29, 29), z = frand(-29, 29), y;
+		if (!ground.height(x, z, y)) continue;
+		Vector3 p(x, y + frand(-1.5f, 1.5f), z);
+		float best = FLT_MAX;
+		for (size_t k = 0; k < indices.size(); k += 3)
+			best = fminf(best, triangleDistance(p, verts[indices[k]], verts[indices[k + 1]], verts[indices[k + 2]]));
+		float exact = p.y() >= y ? best : -best;
+		float d = field.distance(p);
+		if (d != cached.distance(p)) differs++;
+		if (fabsf(exact) >= 0.95f * field.band) continue;
+		double e = fabs(d - exact);
+		sumError += e;
+		if (e > maxError) maxError = e;
+		if ((d < 0) != (exact < 0) && fabsf(exact) > 0.05f) wrongSign++;
+		checked++;
+	}
+	printf("%d points in band: error mean %.4f max %.4f, %d wrong signs, %d differ from the cache\n", checked,
+		checked ? sumError / checked : 0.0, maxError, wrongSign, differs);
+
+	// cost per lookup
+	//
+	std::vector<Vector3> points(numPoints);
+	for (int i = 0; i < numPoints; i++)
+		points[i] = Vector3(frand(-29, 29), frand(-3, 3), frand(-29, 29));
+	float sum = 0;
+	t0 = now();
+	for (int i = 0; i < numPoints; i++)
+		sum += field.distance(points[i]);
+	t1 = now();
+	double lookup = (t1 - t0) * 1e9 / numPoints;
+	Vector3 gradient;
+	float d;
+	t0 = now();
+	for (int i = 0; i < numPoints; i++) {
+		field.sample(points[i], d, gradient);
+		sum += gradient.y();
+	}
+	t1 = now();
+	printf("ns/query: distance %.1f, distance and gradient %.1f (%g)\n", lookup, (t1 - t0) * 1e9 / numPoints, sum);
+	remove(cachePath);
+	return 0;
+}
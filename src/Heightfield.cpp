@@ -0,0 +1,207 @@
+#include "Heightfield.h"
+#include <cmath>
+
+using namespace std;
+
+static const int maxGridPoints = 2048;      // per axis
+
+//  clip the polygon p (n points) to the side of x[axis] = at given by
+//  keep (+1: x >= at, -1: x <= at); returns the new point count
+//
+static int clipPolygon(const Vector3 *p, int n, int axis, float at, float keep, Vector3 *out) {
+	int m = 0;
+	for (int i = 0; i < n; i++) {
+		const Vector3 &a = p[i], &b = p[(i + 1) % n];
+		float da = (a[axis] - at) * keep, db = (b[axis] - at) * keep;
+		if (da >= 0) out[m++] = a;
+		if ((da < 0) != (db < 0))
+			out[m++] = a + (b - a) * (da / (da - db));
+	}
+	return m;
+}
+
+void Heightfield::create(const OctreeCore *surface, float cellSize) {
+	octree = surface;
+	heights.clear();
+	fallback.clear();
+	cellTop.clear();
+	numX = numZ = numFallback = 0;
+	if (surface == NULL || !surface->bUseFaces || surface->numFaces == 0) return;
+	const Vector3 *v = surface->verts;
+	const int *f = surface->faces;
+
+	// extent in x, z; which way the mesh faces (up or down, by projected
+	// area) and its mean projected triangle size
+	//
+	float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+	for (int i = 0; i < surface->numVerts; i++) {
+		minX = fminf(minX, v[i].x());
+		maxX = fmaxf(maxX, v[i].x());
+		minZ = fminf(minZ, v[i].z());
+		maxZ = fmaxf(maxZ, v[i].z());
+	}
+	double upArea = 0, downArea = 0;
+	for (int k = 0; k < surface->numFaces; k++) {
+		Vector3 n = (v[f[3 * k + 1]] - v[f[3 * k]]) ^ (v[f[3 * k + 2]] - v[f[3 * k]]);
+		if (n.y() > 0) upArea += n.y() / 2;
+		else downArea -= n.y() / 2;
+	}
+	float facing = upArea >= downArea ? 1 : -1;
+	if (cellSize <= 0)
+		cellSize = sqrt(2 * (upArea + downArea) / surface->numFaces) / 2;
+	float extent = fmaxf(maxX - minX, maxZ - minZ);
+	if (!(cellSize > 0) || extent / cellSize > maxGridPoints - 1)
+		cellSize = extent > 0 ? extent / (maxGridPoints - 1) : 1;
+
+	cell = cellSize;
+	originX = minX;
+	originZ = minZ;
+	numX = max(2, (int)floor((maxX - minX) / cell + 1e-4f) + 1);
+	numZ = max(2, (int)floor((maxZ - minZ) / cell + 1e-4f) + 1);
+	heights.assign(numX * numZ, NAN);
+	vector<float> lowest(numX * numZ, NAN);
+	fallback.assign((numX - 1) * (numZ - 1), 0);
+	cellTop.assign((numX - 1) * (numZ - 1), -FLT_MAX);
+
+	// rasterize: each grid point inside a triangle's (x, z) footprint takes
+	// the triangle's height there.  On a heightfield the footprints tile
+	// the plane, so a second, different height at a point is an overhang.
+	//
+	const float eps = 1e-5f;
+	for (int k = 0; k < surface->numFaces; k++) {
+		const Vector3 &a = v[f[3 * k]], &b = v[f[3 * k + 1]], &c = v[f[3 * k + 2]];
+		Vector3 n = (b - a) ^ (c - a);
+		float x0 = fminf(a.x(), fminf(b.x(), c.x())), x1 = fmaxf(a.x(), fmaxf(b.x(), c.x()));
+		float z0 = fminf(a.z(), fminf(b.z(), c.z())), z1 = fmaxf(a.z(), fmaxf(b.z(), c.z()));
+
+		// underside of an overhang: flag every cell under its footprint
+		//
+		if (n.y() * facing < -0.01f * n.length()) {
+			int i0 = max(0, (int)floor((x0 - originX) / cell)), i1 = min(numX - 2, (int)floor((x1 - originX) / cell));
+			int j0 = max(0, (int)floor((z0 - originZ) / cell)), j1 = min(numZ - 2, (int)floor((z1 - originZ) / cell));
+			for (int j = j0; j <= j1; j++)
+				for (int i = i0; i <= i1; i++)
+					fallback[j * (numX - 1) + i] = 1;
+		}
+
+		// highest point of the triangle over each cell it crosses: the
+		// triangle is planar, so that is a corner of the triangle clipped
+		// to the cell
+		//
+		{
+			int i0 = max(0, min(numX - 2, (int)floor((x0 - originX) / cell)));
+			int i1 = max(0, min(numX - 2, (int)floor((x1 - originX) / cell)));
+			int j0 = max(0, min(numZ - 2, (int)floor((z0 - originZ) / cell)));
+			int j1 = max(0, min(numZ - 2, (int)floor((z1 - originZ) / cell)));
+			for (int j = j0; j <= j1; j++) {
+				for (int i = i0; i <= i1; i++) {
+					Vector3 poly[16] = { a, b, c }, clipped[16];
+					int n = 3;
+					float cx = originX + i * cell, cz = originZ + j * cell;
+					n = clipPolygon(poly, n, 0, i > 0 ? cx : -FLT_MAX, 1, clipped);
+					n = clipPolygon(clipped, n, 0, i < numX - 2 ? cx + cell : FLT_MAX, -1, poly);
+					n = clipPolygon(poly, n, 2, j > 0 ? cz : -FLT_MAX, 1, clipped);
+					n = clipPolygon(clipped, n, 2, j < numZ - 2 ? cz + cell : FLT_MAX, -1, poly);
+					float &t = cellTop[j * (numX - 1) + i];
+					for (int k = 0; k < n; k++)
+						t = fmaxf(t, poly[k].y());
+				}
+			}
+		}
+
+		float ux = b.x() - a.x(), uz = b.z() - a.z();
+		float vx = c.x() - a.x(), vz = c.z() - a.z();
+		float denom = ux * vz - vx * uz;
+		if (fabsf(denom) < 1e-12f) continue;           // vertical: no footprint
+		int i0 = max(0, (int)ceil((x0 - originX) / cell - eps)), i1 = min(numX - 1, (int)floor((x1 - originX) / cell + eps));
+		int j0 = max(0, (int)ceil((z0 - originZ) / cell - eps)), j1 = min(numZ - 1, (int)floor((z1 - originZ) / cell + eps));
+		for (int j = j0; j <= j1; j++) {
+			for (int i = i0; i <= i1; i++) {
+				float px = originX + i * cell - a.x(), pz = originZ + j * cell - a.z();
+				float s = (px * vz - vx * pz) / denom;
+				float t = (ux * pz - px * uz) / denom;
+				if (s < -eps || t < -eps || s + t > 1 + eps) continue;
+				float y = a.y() + s * (b.y() - a.y()) + t * (c.y() - a.y());
+				int p = j * numX + i;
+				heights[p] = isnan(heights[p]) ? y : fmaxf(heights[p], y);
+				lowest[p] = isnan(lowest[p]) ? y : fminf(lowest[p], y);
+			}
+		}
+	}
+
+	// a cell needs the octree if any corner is off the mesh or has more
+	// than one surface above it
+	//
+	float tolerance = 1e-3f * cell;
+	for (int j = 0; j < numZ; j++) {
+		for (int i = 0; i < numX; i++) {
+			int p = j * numX + i;
+			if (!isnan(heights[p]) && heights[p] - lowest[p] <= tolerance) continue;
+			for (int cj = max(0, j - 1); cj <= min(numZ - 2, j); cj++)
+				for (int ci = max(0, i - 1); ci <= min(numX - 2, i); ci++)
+					fallback[cj * (numX - 1) + ci] = 1;
+		}
+	}
+	for (size_t c = 0; c < fallback.size(); c++)
+		numFallback += fallback[c];
+}
+
+bool Heightfield::height(float x, float z, float & y) const {
+	if (heights.empty()) return false;
+	float fx = (x - originX) / cell, fz = (z - originZ) / cell;
+	if (!(fx >= 0 && fz >= 0 && fx < numX - 1 && fz < numZ - 1)) return false;
+	int i = (int)fx, j = (int)fz;
+	if (fallback[j * (numX - 1) + i]) return false;
+	fx -= i;
+	fz -= j;
+	const float *h = &heights[j * numX + i];
+	float y0 = h[0] + (h[1] - h[0]) * fx;
+	float y1 = h[numX] + (h[numX + 1] - h[numX]) * fx;
+	y = y0 + (y1 - y0) * fz;
+	return true;
+}
+
+bool Heightfield::groundHit(const Vector3 & p, OctreeHit & hit) const {
+	float y;
+	if (height(p.x(), p.z(), y)) {
+		hit = OctreeHit();
+		if (y > p.y()) return false;                // under the (single) surface
+		hit.point = Vector3(p.x(), y, p.z());
+		hit.t = p.y() - y;
+		hit.node = 0;
+		return true;
+	}
+	if (octree == NULL) {
+		hit = OctreeHit();
+		return false;
+	}
+	return octree->closestHit(Ray(p, Vector3(0, -1, 0)), hit);
+}
+
+int Heightfield::groundHits(const Vector3 * points, int numPoints, OctreeHit * hits) const {
+	int numHits = 0;
+	for (int i = 0; i < numPoints; i++)
+		numHits += groundHit(points[i], hits[i]);
+	return numHits;
+}
+
+float Heightfield::altitude(const Vector3 & p) const {
+	OctreeHit hit;
+	return groundHit(p, hit) ? hit.t : FLT_MAX;
+}
+
+float Heightfield::top(float x0, float z0, float x1, float z1) const {
+	if (cellTop.empty()) return -FLT_MAX;
+	// clamped like the build, so the edge cells also answer for the mesh
+	// beyond the last grid line
+	//
+	int i0 = max(0, min(numX - 2, (int)floor((x0 - originX) / cell)));
+	int i1 = max(0, min(numX - 2, (int)floor((x1 - originX) / cell)));
+	int j0 = max(0, min(numZ - 2, (int)floor((z0 - originZ) / cell)));
+	int j1 = max(0, min(numZ - 2, (int)floor((z1 - originZ) / cell)));
+	float y = -FLT_MAX;
+	for (int j = j0; j <= j1; j++)
+		for (int i = i0; i <= i1; i++)
+			y = fmaxf(y, cellTop[j * (numX - 1) + i]);
+	return y;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "vector3.h"
+#include "OctreeCore.h"
+
+//  Heightfield - ground height under (x, z) for a terrain that is mostly
+//  2.5D.  create() samples the face octree's mesh on a regular grid once
+//  (the top surface at each grid point); a lookup is then the bilinear
+//  interpolation of the four grid points around (x, z), with no tree walk.
+//
+//  Cells the grid cannot describe are flagged when it is built and their
+//  lookups cast the straight down ray through the octree instead: cells
+//  with an overhang (a grid point with more than one surface above it, or
+//  a downward facing triangle over the cell) and cells with a grid point
+//  off the mesh.  The grid value is the mesh sampled at the grid points,
+//  so between them it is within the mesh's curvature over one cell of the
+//  exact surface; closestHit() on the octree stays the exact query.
+//
+class Heightfield {
+public:
+
+	// sample surface (a face mode octree, kept for the fallback) every
+	// cellSize in x and z; 0 picks half the mesh's mean edge length
+	//
+	void create(const OctreeCore *surface, float cellSize = 0);
+
+	// ground height at (x, z) from the grid; false where the cell needs the
+	// octree (overhang, off the mesh, or outside the grid)
+	//
+	bool height(float x, float z, float & y) const;
+
+	// surface straight below p: the grid when it can answer, else the down
+	// ray through the octree.  Grid answers have no leaf or face, so they
+	// report node 0 (the root) and index -1; node is -1 on a miss.
+	//
+	bool groundHit(const Vector3 & p, OctreeHit & hit) const;
+	int groundHits(const Vector3 * points, int numPoints, OctreeHit * hits) const;
+
+	// height of p above the ground below it (FLT_MAX if there is none)
+	//
+	float altitude(const Vector3 & p) const;
+
+	// highest point of the mesh over the cells the rectangle [x0, x1] x
+	// [z0, z1] touches, overhangs included (-FLT_MAX if there is no mesh
+	// there).  Exact, not interpolated: a box whose bottom is above it
+	// cannot touch the terrain.
+	//
+	float top(float x0, float z0, float x1, float z1) const;
+
+	bool empty() const { return heights.empty(); }
+
+	// grid: point (i, j) is at origin + (i * cell, j * cell) in x, z
+	//
+	float originX = 0, originZ = 0;
+	float cell = 1;
+	int numX = 0, numZ = 0;
+	std::vector<float> heights;         // top surface at each grid point
+	std::vector<uint8_t> fallback;      // per cell: 1 = ask the octree
+	std::vector<float> cellTop;         // per cell: highest mesh point over it
+	int numFallback = 0;                // cells flagged
+
+private:
+	const OctreeCore *octree = NULL;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+
+//  Integrators for one body under a constant acceleration plus linear drag
+//
+//      x' = v
+//      v' = accel - drag * v
+//
+//  used by LanderSim for both the linear state (Vector3 position /
+//  velocity) and the rotation (float rotation / degVeloc), so T is
+//  anything with + and * float.  drag is per second: a damping factor d
+//  kept per step of h seconds is drag = -ln(d) / h (see dragRate()).
+//
+//  ExplicitEuler is the original lander step (position from the old
+//  velocity, then the velocity, then the damping factor for the step);
+//  the others treat the drag as part of the acceleration so they stay
+//  accurate as the step grows:
+//
+//      SemiImplicitEuler  1st order, symplectic; 1 evaluation
+//      VelocityVerlet     2nd order; 2 evaluations
+//      RungeKutta4        4th order; 4 evaluations
+//
+typedef enum { ExplicitEuler, SemiImplicitEuler, VelocityVerlet, RungeKutta4 } IntegratorType;
+
+inline float dragRate(float damping, float step) {
+	return damping > 0 ? -std::log(damping) / step : 0;
+}
+
+template <class T>
+void integrateMotion(IntegratorType type, T & x, T & v, const T & accel, float drag, float dt) {
+	switch (type) {
+	case ExplicitEuler:
+		x = x + v * dt;
+		v = (v + accel * dt) * std::exp(-drag * dt);
+		break;
+	case SemiImplicitEuler:
+		v = v + (accel + v * -drag) * dt;
+		x = x + v * dt;
+		break;
+	case VelocityVerlet: {
+		T a0 = accel + v * -drag;
+		x = x + v * dt + a0 * (0.5f * dt * dt);
+		T a1 = accel + (v + a0 * dt) * -drag;
+		v = v + (a0 + a1) * (0.5f * dt);
+		break;
+	}
+	case RungeKutta4: {
+		// k1..k4: (dx, dv) at the start, twice at the midpoint, at the end
+		//
+		T dv1 = accel + v * -drag;
+		T v2 = v + dv1 * (0.5f * dt);
+		T dv2 = accel + v2 * -drag;
+		T v3 = v + dv2 * (0.5f * dt);
+		T dv3 = accel + v3 * -drag;
+		T v4 = v + dv3 * dt;
+		T dv4 = accel + v4 * -drag;
+		x = x + (v + (v2 + v3) * 2.0f + v4) * (dt / 6.0f);
+		v = v + (dv1 + (dv2 + dv3) * 2.0f + dv4) * (dt / 6.0f);
+		break;
+	}
+	}
+}
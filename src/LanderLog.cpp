@@ -0,0 +1,332 @@
+#include "LanderLog.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+static const char logMagic[8] = { 'L', 'A', 'N', 'D', 'L', 'O', 'G', 0 };
+static const uint32_t logVersion = 2;
+
+//  record type bytes: 0 .. 7 are the LanderInput values
+//
+static const uint8_t recordPause = 8;
+static const uint8_t recordResume = 9;
+static const uint8_t recordMove = 10;
+
+void LanderLog::begin(const LanderSim & sim, float step, const OctreeCore *terrain, const OctreeCore *surface) {
+	seed = sim.seed;
+	dt = step;
+	terrainHash = terrain ? terrain->cacheHash : 0;
+	terrainLevels = terrain ? terrain->cacheLevels : 0;
+	surfaceHash = surface ? surface->cacheHash : 0;
+	surfaceLevels = surface ? surface->cacheLevels : 0;
+	landerScale = sim.landerScale;
+	startingPosition = sim.position;
+	bounds = sim.bounds;
+	mass = sim.mass;
+	damping = sim.damping;
+	degDamp = sim.degDamp;
+	restitution = sim.restitution;
+	winCon = sim.winCon;
+	startFuel = sim.startFuel;
+	thrust = sim.thrust;
+	rotateForce = sim.rotateForce;
+	integrator = sim.integrator;
+	entries.clear();
+	finish(sim);
+}
+
+void LanderLog::add(const LanderSim & sim, LanderLogEntry & e) {
+	e.tick = sim.tick;
+	entries.push_back(e);
+}
+
+void LanderLog::input(const LanderSim & sim, LanderInput input) {
+	LanderLogEntry e;
+	e.type = LogInput;
+	e.input = input;
+	add(sim, e);
+}
+
+void LanderLog::running(const LanderSim & sim) {
+	LanderLogEntry e;
+	e.type = LogRunning;
+	e.running = sim.running;
+	add(sim, e);
+}
+
+void LanderLog::move(const LanderSim & sim) {
+	LanderLogEntry e;
+	e.type = LogMove;
+	e.position = sim.position;
+	add(sim, e);
+}
+
+void LanderLog::finish(const LanderSim & sim) {
+	endTick = sim.tick;
+	endPosition = sim.position;
+	endRotation = sim.rotation;
+	endFuel = sim.fuel;
+	endCrashed = sim.crashed;
+	endLanded = sim.landed;
+	endRunning = sim.running;
+}
+
+//--------------------------------------------------------------
+//  file format
+
+static void putBytes(vector<uint8_t> & out, const void *p, size_t n) {
+	const uint8_t *b = (const uint8_t *)p;
+	out.insert(out.end(), b, b + n);
+}
+
+template <class T>
+static void put(vector<uint8_t> & out, const T & v) {
+	putBytes(out, &v, sizeof(v));
+}
+
+static void putVector(vector<uint8_t> & out, const Vector3 & v) {
+	float f[3] = { v.x(), v.y(), v.z() };
+	putBytes(out, f, sizeof(f));
+}
+
+static void putVarint(vector<uint8_t> & out, uint32_t v) {
+	while (v >= 0x80) {
+		out.push_back((v & 0x7f) | 0x80);
+		v >>= 7;
+	}
+	out.push_back(v);
+}
+
+//  reads back what the put functions wrote; any read past the end marks
+//  the reader bad (and returns zeros)
+//
+class LogReader {
+public:
+	LogReader(const vector<uint8_t> & data) : p(data.data()), end(data.data() + data.size()) { }
+
+	bool bytes(void *dst, size_t n) {
+		if (end - p < (ptrdiff_t)n) {
+			bad = true;
+			memset(dst, 0, n);
+			return false;
+		}
+		memcpy(dst, p, n);
+		p += n;
+		return true;
+	}
+	template <class T> T get() {
+		T v;
+		bytes(&v, sizeof(v));
+		return v;
+	}
+	Vector3 vector() {
+		float f[3];
+		bytes(f, sizeof(f));
+		return Vector3(f[0], f[1], f[2]);
+	}
+	uint32_t varint() {
+		uint32_t v = 0;
+		for (int shift = 0; shift < 35; shift += 7) {
+			uint8_t b = get<uint8_t>();
+			v |= (uint32_t)(b & 0x7f) << shift;
+			if (!(b & 0x80)) return v;
+		}
+		bad = true;
+		return 0;
+	}
+
+	const uint8_t *p, *end;
+	bool bad = false;
+};
+
+//  write the log to path; a failed or short write removes the partial
+//  file, so a folder of sessions holds only whole logs
+//
+bool LanderLog::save(const string & path) const {
+	vector<uint8_t> out;
+	putBytes(out, logMagic, sizeof(logMagic));
+	put(out, logVersion);
+	put(out, seed);
+	put(out, dt);
+	put(out, terrainHash);
+	put<int32_t>(out, terrainLevels);
+	put(out, surfaceHash);
+	put<int32_t>(out, surfaceLevels);
+	put(out, landerScale);
+	putVector(out, startingPosition);
+	putVector(out, bounds.min());
+	putVector(out, bounds.max());
+	put(out, mass);
+	put(out, damping);
+	put(out, degDamp);
+	put(out, restitution);
+	put(out, winCon);
+	put<int32_t>(out, startFuel);
+	put(out, thrust);
+	put(out, rotateForce);
+	put<int32_t>(out, integrator);
+
+	put<int32_t>(out, endTick);
+	putVector(out, endPosition);
+	put(out, endRotation);
+	put<int32_t>(out, endFuel);
+	uint8_t flags = (endCrashed ? 1 : 0) | (endLanded ? 2 : 0) | (endRunning ? 4 : 0);
+	put(out, flags);
+
+	put<uint32_t>(out, entries.size());
+	int last = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		const LanderLogEntry &e = entries[i];
+		putVarint(out, e.tick - last);
+		last = e.tick;
+		switch (e.type) {
+		case LogInput:
+			out.push_back((uint8_t)e.input);
+			break;
+		case LogRunning:
+			out.push_back(e.running ? recordResume : recordPause);
+			break;
+		case LogMove:
+			out.push_back(recordMove);
+			putVector(out, e.position);
+			break;
+		}
+	}
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (f == NULL) return false;
+	bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	ok = fclose(f) == 0 && ok;
+	if (!ok) remove(path.c_str());
+	return ok;
+}
+
+bool LanderLog::load(const string & path) {
+	FILE *f = fopen(path.c_str(), "rb");
+	if (f == NULL) return false;
+	vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.insert(data.end(), buf, buf + n);
+	fclose(f);
+
+	LogReader in(data);
+	char magic[8];
+	in.bytes(magic, sizeof(magic));
+	if (in.bad || memcmp(magic, logMagic, sizeof(logMagic)) != 0 || in.get<uint32_t>() != logVersion)
+		return false;
+
+	seed = in.get<uint64_t>();
+	dt = in.get<float>();
+	terrainHash = in.get<uint64_t>();
+	terrainLevels = in.get<int32_t>();
+	surfaceHash = in.get<uint64_t>();
+	surfaceLevels = in.get<int32_t>();
+	landerScale = in.get<float>();
+	startingPosition = in.vector();
+	Vector3 bmin = in.vector();
+	Vector3 bmax = in.vector();
+	bounds = Box(bmin, bmax);
+	mass = in.get<float>();
+	damping = in.get<float>();
+	degDamp = in.get<float>();
+	restitution = in.get<float>();
+	winCon = in.get<float>();
+	startFuel = in.get<int32_t>();
+	thrust = in.get<float>();
+	rotateForce = in.get<float>();
+	integrator = (IntegratorType)in.get<int32_t>();
+
+	endTick = in.get<int32_t>();
+	endPosition = in.vector();
+	endRotation = in.get<float>();
+	endFuel = in.get<int32_t>();
+	uint8_t flags = in.get<uint8_t>();
+	endCrashed = flags & 1;
+	endLanded = flags & 2;
+	endRunning = flags & 4;
+
+	uint32_t count = in.get<uint32_t>();
+	entries.clear();
+	int tick = 0;
+	for (uint32_t i = 0; i < count && !in.bad; i++) {
+		LanderLogEntry e;
+		tick += in.varint();
+		e.tick = tick;
+		uint8_t type = in.get<uint8_t>();
+		if (type <= RotateBack) {
+			e.type = LogInput;
+			e.input = (LanderInput)type;
+		}
+		else if (type == recordPause || type == recordResume) {
+			e.type = LogRunning;
+			e.running = type == recordResume;
+		}
+		else if (type == recordMove) {
+			e.type = LogMove;
+			e.position = in.vector();
+		}
+		else
+			return false;
+		entries.push_back(e);
+	}
+	return !in.bad;
+}
+
+//--------------------------------------------------------------
+//  replay
+
+void LanderLog::setup(LanderSim & sim) const {
+	sim.landerScale = landerScale;
+	sim.startingPosition = startingPosition;
+	sim.bounds = bounds;
+	sim.mass = mass;
+	sim.damping = damping;
+	sim.degDamp = degDamp;
+	sim.restitution = restitution;
+	sim.winCon = winCon;
+	sim.startFuel = startFuel;
+	sim.thrust = thrust;
+	sim.rotateForce = rotateForce;
+	sim.integrator = integrator;
+	sim.reset(seed);
+}
+
+//  apply the events of each tick, then step while running, as the app
+//  did; stops at the recorded end tick, or when the sim stops with no
+//  events left for this tick.  Returns the last non-LanderNone event.
+//
+LanderEvent LanderLog::replay(LanderSim & sim) const {
+	LanderEvent last = LanderNone;
+	size_t next = 0;
+	while (next < entries.size() && entries[next].tick < sim.tick) next++;
+	while (true) {
+		while (next < entries.size() && entries[next].tick == sim.tick) {
+			const LanderLogEntry &e = entries[next++];
+			switch (e.type) {
+			case LogInput:
+				sim.apply(e.input);
+				break;
+			case LogRunning:
+				sim.running = e.running;
+				break;
+			case LogMove:
+				sim.position = e.position;
+				sim.previousPosition = e.position;
+				break;
+			}
+		}
+		if (sim.tick >= endTick || !sim.running) break;
+		LanderEvent event = sim.step(dt);
+		if (event != LanderNone) last = event;
+	}
+	return last;
+}
+
+bool LanderLog::matches(const LanderSim & sim) const {
+	return sim.tick == endTick && sim.position == endPosition && sim.rotation == endRotation &&
+		sim.fuel == endFuel && sim.crashed == endCrashed && sim.landed == endLanded &&
+		sim.running == endRunning;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LanderSim.h"
+
+//  LanderLog - a recorded landing: the settings, seed and terrain the sim
+//  started from, then every pilot input (plus pause / resume and the
+//  lander being dragged to a new spot) at the simulation tick it took
+//  effect.  replay() drives a LanderSim through the same session at full
+//  speed, without rendering, and matches() checks it ended in the state
+//  that was recorded.
+//
+//  The file is a small fixed header followed by one record per event: the
+//  tick as a varint delta from the previous event and a type byte (plus
+//  the position for a move), so a typical input costs 2 bytes.
+//
+
+//  LanderLogType - what a log entry does
+//
+typedef enum { LogInput, LogRunning, LogMove } LanderLogType;
+
+class LanderLogEntry {
+public:
+	int tick = 0;
+	LanderLogType type = LogInput;
+	LanderInput input = ThrustUp;       // LogInput
+	bool running = false;               // LogRunning
+	Vector3 position = Vector3(0, 0, 0); // LogMove
+};
+
+class LanderLog {
+public:
+
+	// recording: begin() right after sim.reset(), then one call per
+	// event, finish() before save()
+	//
+	void begin(const LanderSim & sim, float dt, const OctreeCore *terrain = NULL,
+		const OctreeCore *surface = NULL);
+	void input(const LanderSim & sim, LanderInput input);
+	void running(const LanderSim & sim);
+	void move(const LanderSim & sim);
+	void finish(const LanderSim & sim);
+	bool save(const std::string & path) const;
+	bool load(const std::string & path);
+
+	// replay: setup() applies the recorded settings and resets sim, replay()
+	// runs it to the recorded end
+	//
+	void setup(LanderSim & sim) const;
+	LanderEvent replay(LanderSim & sim) const;
+	bool matches(const LanderSim & sim) const;
+
+	// session start
+	//
+	uint64_t seed = 0;
+	float dt = 1.0 / 60;
+	uint64_t terrainHash = 0;           // OctreeCore::cacheHash of the collider
+	int terrainLevels = 0;
+	uint64_t surfaceHash = 0;           // and of the surface (face) octree
+	int surfaceLevels = 0;
+	float landerScale = 0.1;
+	Vector3 startingPosition = Vector3(0, 0, 0);
+	Box bounds = Box(Vector3(0, 0, 0), Vector3(0, 0, 0));
+	float mass = 1, damping = 0.99, degDamp = 0.99;
+	float restitution = 0.5, winCon = 5;
+	int startFuel = 250;
+	float thrust = 5, rotateForce = 75;
+	IntegratorType integrator = ExplicitEuler;
+
+	std::vector<LanderLogEntry> entries;
+
+	// session end
+	//
+	int endTick = 0;
+	Vector3 endPosition = Vector3(0, 0, 0);
+	float endRotation = 0;
+	int endFuel = 0;
+	bool endCrashed = false;
+	bool endLanded = false;
+	bool endRunning = false;
+
+private:
+	void add(const LanderSim & sim, LanderLogEntry & e);
+};
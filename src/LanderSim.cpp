@@ -0,0 +1,326 @@
+#include "LanderSim.h"
+
+void LanderSim::setTerrain(const OctreeCore *collider, const OctreeCore *surf, const Heightfield *heights,
+	const TerrainSdf *distances) {
+	collision.setOctree(collider);
+	contacts.setOctree(surf);
+	surface = surf;
+	ground = heights;
+	field = distances;
+}
+
+//  restart the landing: lander back at the start with full fuel, and a new
+//  turbulence drawn from seed
+//
+void LanderSim::reset(uint64_t s) {
+	seed = s;
+	rng.seed(seed);
+	gravityForce = Vector3(0, -1.64 * landerScale, 0);      //moon gravity
+	turbulentForce = Vector3(rng.range(-0.0164, 0.0164), rng.range(-0.0164, 0.0164), rng.range(-0.0164, 0.0164));
+	forces = gravityForce + turbulentForce;
+	position = startingPosition;
+	previousPosition = position;
+	velocity = Vector3(0, 0, 0);
+	rotation = 0;
+	previousRotation = 0;
+	degVeloc = 0;
+	degForce = 0;
+	fuel = startFuel;
+	tick = 0;
+	running = true;
+	crashed = false;
+	landed = false;
+	collision.startNode = 0;
+	contacts.startNode = 0;
+	contactNormal = Vector3(0, 1, 0);
+	contactDepth = 0;
+	impact = false;
+	impactNormal = Vector3(0, 1, 0);
+}
+
+//  apply one pilot command; returns true if it fired a thruster (used fuel)
+//
+bool LanderSim::apply(LanderInput input) {
+	switch (input) {
+	case ThrustForward:
+		fuel--;
+		forces = forces + Vector3(0, 0, thrust);
+		return true;
+	case ThrustBack:
+		fuel--;
+		forces = forces + Vector3(0, 0, -thrust);
+		return true;
+	case ThrustUp:
+		fuel -= 2;
+		forces = forces + Vector3(0, thrust, 0);
+		return true;
+	case ThrustDown:
+		fuel--;
+		forces = forces + Vector3(0, -thrust, 0);
+		return true;
+	case ThrustRight:
+		fuel--;
+		forces = forces + Vector3(-thrust, 0, 0);
+		return true;
+	case ThrustLeft:
+		fuel--;
+		forces = forces + Vector3(thrust, 0, 0);
+		return true;
+	case RotateForward:
+		degForce = -rotateForce;
+		return false;
+	case RotateBack:
+		degForce += rotateForce;
+		return false;
+	}
+	return false;
+}
+
+//  advance the lander by dt seconds: contact with the terrain, fuel check,
+//  then integrate the forces accumulated since the last step, stopping
+//  the move where it first meets the terrain
+//
+LanderEvent LanderSim::step(float dt) {
+	previousPosition = position;
+	previousRotation = rotation;
+	LanderEvent event = checkCollisions(dt);
+	if (fuel <= 0) {
+		if (running && event == LanderNone) event = LanderOutOfFuel;
+		running = false;
+		crashed = true;
+	}
+	Vector3 start = position;
+	updateForce(dt);
+	clampMotion(start);
+	tick++;
+	return event;
+}
+
+//  run from the current state: each command is applied at the start of
+//  its tick (commands sorted by tick).  Stops after numSteps, or at the
+//  first landing or crash; returns the event that ended the run.
+//
+LanderEvent LanderSim::run(const std::vector<LanderCommand> & commands, int numSteps, float dt) {
+	size_t next = 0;
+	while (next < commands.size() && commands[next].tick < tick) next++;
+	for (int i = 0; i < numSteps; i++) {
+		while (next < commands.size() && commands[next].tick == tick)
+			apply(commands[next++].input);
+		LanderEvent event = step(dt);
+		if (event != LanderNone) return event;
+	}
+	return LanderNone;
+}
+
+//  lander box in world space
+//
+Box LanderSim::worldBounds() const {
+	return Box(bounds.min() + position, bounds.max() + position);
+}
+
+//  lander position / rotation alpha of the way from the previous step to
+//  the current one
+//
+Vector3 LanderSim::drawPosition(float alpha) const {
+	return previousPosition + (position - previousPosition) * alpha;
+}
+
+float LanderSim::drawRotation(float alpha) const {
+	return previousRotation + (rotation - previousRotation) * alpha;
+}
+
+//  lander box in world space, turned with the lander
+//
+Obb LanderSim::worldObb() const {
+	return Obb(bounds, position, rotation);
+}
+
+//  terrain surface straight below the lander
+//
+bool LanderSim::groundHit(OctreeHit & hit) const {
+	if (ground != NULL && !ground->empty()) return ground->groundHit(position, hit);
+	if (surface == NULL) return false;
+	Ray ray = Ray(position, Vector3(0, -1, 0));
+	return surface->closestHit(ray, hit);
+}
+
+//  closest approach of the lander box to the terrain: the smallest signed
+//  distance at its 8 corners (negative when one is below the surface),
+//  clamped to the field's band; FLT_MAX without a field
+//
+float LanderSim::clearance() const {
+	if (field == NULL || field->empty()) return FLT_MAX;
+	Obb box = worldObb();
+	float d = FLT_MAX;
+	for (int i = 0; i < 8; i++) {
+		Vector3 corner = box.center;
+		for (int k = 0; k < 3; k++)
+			corner = corner + box.axis[k] * (((i >> k) & 1) ? box.half[k] : -box.half[k]);
+		d = fminf(d, field->distance(corner));
+	}
+	return d;
+}
+
+//  true when box is certainly clear of the surface: its bottom is above
+//  the highest point of the whole mesh, or of the mesh under it by the
+//  height grid.  Lets a lander in flight skip the face octree walk.
+//
+bool LanderSim::aboveTerrain(const Box & box) const {
+	float bottom = box.min().y();
+	if (surface->numNodes == 0 || bottom > surface->nodes[0].box.max().y()) return true;
+	if (ground == NULL || ground->empty()) return false;
+	return bottom > ground->top(box.min().x(), box.min().z(), box.max().x(), box.max().z());
+}
+
+//  world bounds of the lander box at at, whatever its yaw: the yaw only
+//  turns the box about y, so its corners stay within the circle through
+//  the farthest one (no trig, unlike worldObb())
+//
+Box LanderSim::anyYawBounds(const Vector3 & at) const {
+	float x = fmaxf(fabsf(bounds.min().x()), fabsf(bounds.max().x()));
+	float z = fmaxf(fabsf(bounds.min().z()), fabsf(bounds.max().z()));
+	float r = sqrtf(x * x + z * z);
+	return Box(at + Vector3(-r, bounds.min().y(), -r), at + Vector3(r, bounds.max().y(), r));
+}
+
+//  contact impulse against the terrain.  An impulse above winCon is a crash,
+//  anything softer a landing.
+//
+//  With a face octree the rotated lander box is tested against the terrain
+//  triangles: the contact normal is the depth weighted average of the
+//  touching triangles' normals, and the lander is pushed out of the
+//  terrain by the deepest penetration.  Otherwise any overlap of the lander
+//  box with a point octree leaf is a contact on flat ground.  A lander
+//  stopped at the terrain by the last step's sweep is in contact even if
+//  the boxes only touch; one already moving away gets no impulse.
+//
+LanderEvent LanderSim::checkCollisions(float dt) {
+	Vector3 norm = Vector3(0, 1, 0);
+	if (surface != NULL) {
+		if (!impact && aboveTerrain(anyYawBounds(position))) {
+			contacts.contacts.clear();
+			contacts.boxes.clear();
+			return LanderNone;
+		}
+		if (contacts.query(worldObb()) == 0) {
+			if (!impact) return LanderNone;
+			contacts.contacts.clear();
+		}
+		Vector3 sum = Vector3(0, 0, 0);
+		float deepest = 0;
+		for (size_t i = 0; i < contacts.contacts.size(); i++) {
+			const OctreeContact & c = contacts.contacts[i];
+			sum = sum + c.normal * (c.depth > 0 ? c.depth : 0);
+			if (c.depth > deepest) deepest = c.depth;
+		}
+		if (sum.length() > 0) {
+			norm = sum;
+			norm.normalize();
+		}
+		else norm = contacts.contacts.empty() ? impactNormal : contacts.contacts[0].normal;
+		position = position + norm * deepest;
+		contactDepth = deepest;
+	}
+	else {
+		if (!collision.query(worldBounds()) && !impact) return LanderNone;
+		contactDepth = 0;
+	}
+	contactNormal = norm;
+	if (velocity * norm >= 0) return LanderNone;
+
+	//force = (restitution + 1) * (-vdotn) * n
+	//(the impulse replaces the forces accumulated for this step)
+	//
+	Vector3 imp = norm * ((restitution + 1.0) * (-velocity * norm));
+	forces = imp + imp / dt;
+
+	if (imp * norm > winCon) {
+		crashed = true;
+		running = false;
+		return LanderCrashed;
+	}
+	landed = true;
+	return LanderLanded;
+}
+
+//  integrate position / rotation with the chosen integrator and reset the
+//  forces to gravity + turbulence for the next step
+//
+void LanderSim::updateForce(float dt) {
+
+	// acceleration from the accumulated forces
+	// remember :  (f = ma) OR (a = 1/m * f)
+	//
+	Vector3 accel = acceleration + forces * (1.0 / mass);
+	float rcel = degAccel + degForce;
+
+	// damping (kept per 1/60 sec) as a drag rate, so it does not depend
+	// on the step size
+	//
+	integrateMotion(integrator, position, velocity, accel, dragRate(damping, 1.0 / 60), dt);
+	integrateMotion(integrator, rotation, degVeloc, rcel, dragRate(degDamp, 1.0 / 60), dt);
+
+	forces = gravityForce + turbulentForce;
+	degForce = 0;
+}
+
+//  sweep the lander box from start to the integrated position and stop it
+//  at the earliest time of impact with the terrain, so no step is long
+//  enough to carry it through (the velocity is kept for the next step's
+//  contact).  The box is the rotated lander box against the face octree,
+//  or its unrotated box against the leaf boxes.  A box resting on the
+//  terrain and driven into it is stopped where it is.
+//
+//  A move shorter than half the box's thinnest side cannot carry its
+//  center through a surface (the box is at least that thick along any
+//  normal), so the next contact still pushes it out on the side it came
+//  from; a move whose swept bounds stay above the terrain cannot reach
+//  it.  Only the others pay for the sweep.
+//
+void LanderSim::clampMotion(const Vector3 & start) {
+	Vector3 motion = position - start;
+	Vector3 size = bounds.max() - bounds.min();
+	float t;
+	impact = false;
+	if (motion.length() < 0.5f * fminf(size.x(), fminf(size.y(), size.z())))
+		return;
+	if (surface != NULL) {
+		Box box = anyYawBounds(start);
+		Box swept(box.min() + Vector3(fminf(motion.x(), 0), fminf(motion.y(), 0), fminf(motion.z(), 0)),
+			box.max() + Vector3(fmaxf(motion.x(), 0), fmaxf(motion.y(), 0), fmaxf(motion.z(), 0)));
+		if (!aboveTerrain(swept))
+			impact = contacts.sweep(Obb(bounds, start, rotation), motion, t, impactNormal);
+	}
+	else if (collision.sweep(Box(bounds.min() + start, bounds.max() + start), motion, t, impactNormal))
+		impact = true;
+	if (impact)
+		position = start + motion * t;
+}
+
+//--------------------------------------------------------------
+//  LanderDrag
+
+//  start from the sim's position, not the drawn one (which lags it by up
+//  to a step)
+//
+void LanderDrag::press(const LanderSim & sim) {
+	active = true;
+	moved = false;
+	position = sim.position;
+}
+
+void LanderDrag::drag(const Vector3 & delta) {
+	if (!active) return;
+	position = position + delta;
+	if (delta != Vector3(0, 0, 0)) moved = true;
+}
+
+bool LanderDrag::release(LanderSim & sim) {
+	bool drop = active && moved;
+	active = false;
+	moved = false;
+	if (!drop) return false;
+	sim.position = position;
+	sim.previousPosition = position;
+	return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "vector3.h"
+#include "box.h"
+#include "OctreeCore.h"
+#include "Heightfield.h"
+#include "TerrainSdf.h"
+#include "Rng.h"
+#include "Integrator.h"
+
+//  LanderSim - the lander physics and game rules without openFrameworks,
+//  so landings can be run headless (batch runs, tools, servers).  The
+//  app feeds it the pilot's commands and draws the result; a headless
+//  runner feeds it a recorded or generated command stream instead.  With
+//  the same seed, terrain, commands and step sizes a run is repeatable.
+//
+
+//  LanderInput - one pilot command (one key press in the app)
+//
+typedef enum {
+	ThrustForward, ThrustBack, ThrustUp, ThrustDown, ThrustRight, ThrustLeft,
+	RotateForward, RotateBack
+} LanderInput;
+
+//  LanderEvent - what happened during a step
+//
+typedef enum { LanderNone, LanderLanded, LanderCrashed, LanderOutOfFuel } LanderEvent;
+
+//  LanderCommand - an input applied at the start of simulation step tick
+//
+class LanderCommand {
+public:
+	int tick = 0;
+	LanderInput input = ThrustUp;
+};
+
+class LanderSim {
+public:
+
+	// terrain: surface is the face octree used for altitude and, when
+	// given, for contact (the rotated lander box against the triangles);
+	// without it contact falls back to the lander box against the leaf
+	// boxes of the collider point octree, with an up normal.  ground, a
+	// Heightfield of surface, answers the altitude queries without the
+	// tree walk, and field, its TerrainSdf, the clearance queries.
+	//
+	void setTerrain(const OctreeCore *collider, const OctreeCore *surface = NULL,
+		const Heightfield *ground = NULL, const TerrainSdf *field = NULL);
+	void reset(uint64_t seed);
+	bool apply(LanderInput input);
+	LanderEvent step(float dt);
+	LanderEvent run(const std::vector<LanderCommand> & commands, int numSteps, float dt);
+	Box worldBounds() const;
+	Obb worldObb() const;
+	bool groundHit(OctreeHit & hit) const;
+	float clearance() const;
+
+	// state for drawing between the last two steps (alpha from SimClock)
+	//
+	Vector3 drawPosition(float alpha) const;
+	float drawRotation(float alpha) const;
+
+	// settings (not changed by reset)
+	//
+	float landerScale = 0.1;
+	Vector3 startingPosition = Vector3(0, 20, -30);
+	Box bounds = Box(Vector3(0, 0, 0), Vector3(0, 0, 0));    // lander box around position
+	float mass = 1.0;
+	float damping = 0.99;           //velocity kept per 1/60 sec
+	float degDamp = 0.99;
+	IntegratorType integrator = ExplicitEuler;  //see Integrator.h
+	float restitution = 0.5;        //bounciness
+	float winCon = 5;               //max impulse for a safe landing
+	int startFuel = 250;
+	float thrust = 5;
+	float rotateForce = 75;
+
+	// state
+	//
+	Vector3 position = startingPosition;
+	Vector3 previousPosition = startingPosition;  //before the last step
+	Vector3 velocity = Vector3(0, 0, 0);
+	Vector3 acceleration = Vector3(0, 0, 0);
+	Vector3 forces = Vector3(0, 0, 0);
+	Vector3 gravityForce = Vector3(0, 0, 0);
+	Vector3 turbulentForce = Vector3(0, 0, 0);
+	float rotation = 0.0;
+	float previousRotation = 0.0;
+	float degVeloc = 0.0;
+	float degAccel = 0.0;
+	float degForce = 0.0;
+	int fuel = 250;
+	int tick = 0;                   //steps taken since reset
+	uint64_t seed = 0;              //seed of the last reset
+	bool running = true;            //false once crashed / out of fuel
+	bool crashed = false;
+	bool landed = false;
+
+	OctreeCollisionQuery collision; //last point octree query (colliding leaf boxes)
+	OctreeContactQuery contacts;    //last terrain contacts (face octree)
+	Vector3 contactNormal = Vector3(0, 1, 0);   //normal of the last contact
+	float contactDepth = 0;         //its penetration (before the push out)
+	bool impact = false;            //last step's motion was stopped at the terrain
+	Vector3 impactNormal = Vector3(0, 1, 0);    //normal it was stopped by
+
+private:
+	LanderEvent checkCollisions(float dt);
+	bool aboveTerrain(const Box & box) const;
+	Box anyYawBounds(const Vector3 & at) const;
+	void updateForce(float dt);
+	void clampMotion(const Vector3 & start);
+
+	const OctreeCore *surface = NULL;
+	const Heightfield *ground = NULL;
+	const TerrainSdf *field = NULL;
+	Rng rng;
+};
+
+//  LanderDrag - the pilot dragging the lander to a new spot with the
+//  mouse: press() when the lander is picked, drag() with each mouse move
+//  (world units), release() on mouse up.  release() drops the lander
+//  where it was dragged to and returns true; a click that never moved it,
+//  or a release with no lander picked (camera drag, gui click), leaves
+//  the sim alone and returns false.
+//
+class LanderDrag {
+public:
+	void press(const LanderSim & sim);
+	void drag(const Vector3 & delta);
+	bool release(LanderSim & sim);
+
+	bool active = false;            //lander picked, mouse still down
+	bool moved = false;             //dragged since the press
+	Vector3 position = Vector3(0, 0, 0);    //where it is dragged to
+};
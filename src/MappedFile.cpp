@@ -0,0 +1,57 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string & path) {
+	close();
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) return false;
+	ptr = (const char *)p;
+	length = st.st_size;
+	return true;
+#else
+	FILE *f = fopen(path.c_str(), "rb");
+	if (f == NULL) return false;
+	fseek(f, 0, SEEK_END);
+	long n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (n <= 0) {
+		fclose(f);
+		return false;
+	}
+	buffer.resize(n);
+	bool ok = fread(&buffer[0], 1, n, f) == (size_t)n;
+	fclose(f);
+	if (!ok) {
+		buffer.clear();
+		return false;
+	}
+	ptr = &buffer[0];
+	length = n;
+	return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+	if (ptr != NULL) munmap((void *)ptr, length);
+#endif
+	buffer.clear();
+	ptr = NULL;
+	length = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+//  MappedFile - read-only memory mapping of a whole file (mmap on POSIX;
+//  on Windows the file is read into memory instead).  The mapping lives
+//  until close() or destruction, so it is not copyable.
+//
+class MappedFile {
+public:
+	MappedFile() { }
+	~MappedFile() { close(); }
+
+	bool open(const std::string & path);
+	void close();
+	bool isOpen() const { return ptr != NULL; }
+	const char * data() const { return ptr; }
+	size_t size() const { return length; }
+	void swap(MappedFile & other) {
+		std::swap(ptr, other.ptr);
+		std::swap(length, other.length);
+		buffer.swap(other.buffer);
+	}
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const char *ptr = NULL;
+	size_t length = 0;
+	std::vector<char> buffer;       // fallback when mmap is unavailable
+};
@@ -68,8 +68,9 @@ int Octree::getMeshPointsInBox(const ofMesh & mesh, const vector<int>& points,
 	return count;
 }
 
-// getMeshFacesInBox:  return an array of indices to Faces in mesh that are contained 
-//                      inside the Box.  Return count of faces found;
+// getMeshFacesInBox:  return an array of indices to Faces in mesh that overlap
+//                      the Box (including faces that straddle it).  Return
+//                      count of faces found;
 //
 int Octree::getMeshFacesInBox(const ofMesh & mesh, const vector<int>& faces,
 	Box & box, vector<int> & facesRtn)
@@ -85,7 +86,7 @@ int Octree::getMeshFacesInBox(const ofMesh & mesh, const vector<int>& faces,
 		p[0] = Vector3(v[0].x, v[0].y, v[0].z);
 		p[1] = Vector3(v[1].x, v[1].y, v[1].z);
 		p[2] = Vector3(v[2].x, v[2].y, v[2].z);
-		if (box.inside(p,3)) {
+		if (box.overlap(p[0], p[1], p[2])) {
 			count++;
 			facesRtn.push_back(faces[i]);
 		}
@@ -96,107 +97,90 @@ int Octree::getMeshFacesInBox(const ofMesh & mesh, const vector<int>& faces,
 //  Subdivide a Box into eight(8) equal size boxes, return them in boxList;
 //
 void Octree::subDivideBox8(const Box &box, vector<Box> & boxList) {
-	Vector3 min = box.parameters[0];
-	Vector3 max = box.parameters[1];
-	Vector3 size = max - min;
-	Vector3 center = size / 2 + min;
-	float xdist = (max.x() - min.x()) / 2;
-	float ydist = (max.y() - min.y()) / 2;
-	float zdist = (max.z() - min.z()) / 2;
-	Vector3 h = Vector3(0, ydist, 0);
-
-	//  generate ground floor
-	//
 	Box b[8];
-	b[0] = Box(min, center);
-	b[1] = Box(b[0].min() + Vector3(xdist, 0, 0), b[0].max() + Vector3(xdist, 0, 0));
-	b[2] = Box(b[1].min() + Vector3(0, 0, zdist), b[1].max() + Vector3(0, 0, zdist));
-	b[3] = Box(b[2].min() + Vector3(-xdist, 0, 0), b[2].max() + Vector3(-xdist, 0, 0));
-
-	boxList.clear();
-	for (int i = 0; i < 4; i++)
-		boxList.push_back(b[i]);
-
-	// generate second story
-	//
-	for (int i = 4; i < 8; i++) {
-		b[i] = Box(b[i - 4].min() + h, b[i - 4].max() + h);
-		boxList.push_back(b[i]);
+	subDivideBox8(box, b);
+	boxList.assign(b, b + 8);
+}
+
+//  copy the vertex positions and triangle indices out of an ofMesh
+//
+void Octree::meshData(const ofMesh & mesh, vector<Vector3> & vertices, vector<int> & indices) {
+	int n = mesh.getNumVertices();
+	vertices.resize(n);
+	for (int i = 0; i < n; i++) {
+		ofVec3f v = mesh.getVertex(i);
+		vertices[i] = Vector3(v.x, v.y, v.z);
 	}
+	indices.resize(mesh.getNumIndices());
+	for (int i = 0; i < indices.size(); i++)
+		indices[i] = mesh.getIndex(i);
 }
 
 void Octree::create(const ofMesh & geo, int numLevels) {
-	// initialize octree structure
-	//
 	mesh = geo;
-	int level = 0;
-	root.box = meshBounds(mesh);
-	if (!bUseFaces) {
-		for (int i = 0; i < mesh.getNumVertices(); i++) {
-			root.points.push_back(i);
-		}
-	}
-	else {
-		// need to load face vertices here
-		//
+	vector<Vector3> vertices;
+	vector<int> indices;
+	meshData(mesh, vertices, indices);
+	OctreeCore::create(vertices, indices, numLevels);
+	root = TreeNode();
+	if (numNodes > 0) {
+		root.box = nodes[0].box;
+		root.index = 0;
 	}
+}
 
-	// recursively buid octree
-	//
-	level++;
-    subdivide(mesh, root, numLevels, level);
-}
-
-
-void Octree::subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level) {
-	if (level >= numLevels) return;
-	vector<Box> boxList;
-	subDivideBox8(node.box, boxList);
-	level++;
-	int pointsInNode = node.points.size();
-	int totalPoints = 0;
-	for (int i = 0; i < boxList.size(); i++) {
-		TreeNode child;
-		int count = 0;
-		if (!bUseFaces)
-			count = getMeshPointsInBox(mesh, node.points, boxList[i], child.points);
-		else 
-			count = getMeshFacesInBox(mesh, node.points, boxList[i], child.points);
-		totalPoints += count;
-
-		if (count > 0) {
-			child.box = boxList[i];
-			node.children.push_back(child);
-			if (count > 1) {
-				subdivide(mesh, node.children.back(), numLevels, level);
-			}
-		}
-
-	
-	}
-	// debug
-	//
-	if (pointsInNode != totalPoints) {
-		strayVerts += (pointsInNode - totalPoints);
+bool Octree::createCached(const ofMesh & geo, int numLevels, const string & cachePath) {
+	mesh = geo;
+	vector<Vector3> vertices;
+	vector<int> indices;
+	meshData(mesh, vertices, indices);
+	bool cached = OctreeCore::createCached(vertices, indices, numLevels, cachePath);
+	root = TreeNode();
+	if (numNodes > 0) {
+		root.box = nodes[0].box;
+		root.index = 0;
 	}
+	return cached;
+}
+
+//  return a TreeNode view (box and point list) of a node in the pool
+//
+TreeNode Octree::getNode(int index) const {
+	TreeNode node;
+	const OctreeNode & n = nodes[index];
+	node.box = n.box;
+	node.index = index;
+	node.points.assign(pointIndices + n.pointStart,
+		pointIndices + n.pointStart + n.pointCount);
+	return node;
 }
 
 //ray intersection with octree / selection of point
 bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn) {
+	if (node.index < 0 || node.index >= numNodes) return false;
+	int leaf = -1;
+	bool intersects = intersect(ray, node.index, leaf);
+	if (intersects)
+		nodeRtn = getNode(leaf);
+	return intersects;
+}
+
+bool Octree::intersect(const Ray &ray, int nodeIndex, int & leafRtn) {
 	bool intersects = false;
-    
+	const OctreeNode & node = nodes[nodeIndex];
+
     //check intersection of ray and node box
     if(node.box.intersect(ray, -1000, 1000)) {
-        if(node.points.size() == 0)
+        if(node.pointCount == 0)
             intersects = false;         //if none, still false
-        else if(node.points.size() == 1) {
-            nodeRtn = node;     //assign node if met, return true
+        else if(node.numChildren == 0) {
+            leafRtn = nodeIndex;     //assign node if met, return true
             intersects = true;
         }
         else {
             //recursive call to intersect function
-            for(int i = 0; i < node.children.size(); i++) {
-                if(intersect(ray, node.children[i], nodeRtn))
+            for(int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+                if(intersect(ray, i, leafRtn))
                     intersects = true;      //exit if found true
             }
         }
@@ -205,38 +189,36 @@ bool Octree::intersect(const Ray &ray, const TreeNode & node, TreeNode & nodeRtn
 }
 
 bool Octree::intersect(const Box &box, TreeNode & node, vector<Box> & boxListRtn) {
-	bool intersects = false;
-    if(node.box.overlap(box)) {
-        if(node.points.size() == 0)
-            intersects = false;
-        else if(node.points.size() == 1) {
-            boxListRtn.push_back(node.box);     //push box to list if intersect box
-            intersects = true;
-        }
-        else {
-            for(int i = 0; i < node.children.size(); i++) {
-                if(intersect(box, node.children[i], boxListRtn))
-                    intersects = true;
-            }
-        }
-    }
-	return intersects;
+	if (node.index < 0 || node.index >= numNodes) return false;
+	return intersectNode(box, node.index, boxListRtn, NULL);
 }
 
 // draw Octree (recursively)
 //
 void Octree::draw(TreeNode & node, int numLevels, int level) {
+	if (node.index < 0 || node.index >= numNodes) return;
+	draw(node.index, numLevels, level);
+}
+
+void Octree::draw(int nodeIndex, int numLevels, int level) {
     if (level >= numLevels) return;
+    const OctreeNode & node = nodes[nodeIndex];
     drawBox(node.box);
     level++;
-    for (int i = 0; i < node.children.size(); i++) {
-        draw(node.children[i], numLevels, level);
+    for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+        draw(i, numLevels, level);
     }
 }
 
 
 void Octree::drawLeafNodes(TreeNode & node) {
-    if(node.children.size() == 0) {
+	if (node.index < 0 || node.index >= numNodes) return;
+	drawLeafNodes(node.index);
+}
+
+void Octree::drawLeafNodes(int nodeIndex) {
+    const OctreeNode & node = nodes[nodeIndex];
+    if(node.numChildren == 0) {
         ofFill();
         ofSetColor(ofColor::lightGray);
         numLeaf++;
@@ -246,9 +228,7 @@ void Octree::drawLeafNodes(TreeNode & node) {
         drawBox(node.box);
         return;
     }
-    
-    for(int i = 0; i < node.children.size(); i++)
-        drawLeafNodes(node.children[i]);
-}
- 
 
+    for(int i = node.firstChild; i < node.firstChild + node.numChildren; i++)
+        drawLeafNodes(i);
+}
@@ -4,29 +4,38 @@
 //  Kevin M. Smith
 //
 //  Simple Octree Implementation 11/10/2020
-// 
+//
 //  Copyright (c) by Kevin M. Smith
 //  Copying or use without permission is prohibited by law.
 //
 #pragma once
 #include "ofMain.h"
-#include "box.h"
-#include "ray.h"
-
+#include "OctreeCore.h"
 
 
+//  TreeNode - view of a single node in the pool.  Queries fill these in
+//  so existing callers can keep using node.box and node.points.
+//
 class TreeNode {
 public:
 	Box box;
 	vector<int> points;
-	vector<TreeNode> children;
+	int index = -1;             // index of node in Octree::nodes
 };
 
-class Octree {
+//  Octree - OctreeCore built from an ofMesh, plus drawing and the
+//  TreeNode based queries used by the app
+//
+class Octree : public OctreeCore {
 public:
-	
+	using OctreeCore::create;
+	using OctreeCore::createCached;
+	using OctreeCore::intersect;
+	using OctreeCore::subDivideBox8;
+
 	void create(const ofMesh & mesh, int numLevels);
-	void subdivide(const ofMesh & mesh, TreeNode & node, int numLevels, int level);
+	bool createCached(const ofMesh & mesh, int numLevels, const string & cachePath);
+	static void meshData(const ofMesh & mesh, vector<Vector3> & vertices, vector<int> & indices);
 	bool intersect(const Ray &, const TreeNode & node, TreeNode & nodeRtn);
 	bool intersect(const Box &, TreeNode & node, vector<Box> & boxListRtn);
 	void draw(TreeNode & node, int numLevels, int level);
@@ -34,6 +43,7 @@ public:
 		draw(root, numLevels, level);
 	}
     void drawLeafNodes(TreeNode & node);
+	TreeNode getNode(int index) const;
 	static void drawBox(const Box &box);
 	static Box meshBounds(const ofMesh &);
 	int getMeshPointsInBox(const ofMesh &mesh, const vector<int> & points, Box & box, vector<int> & pointsRtn);
@@ -42,10 +52,13 @@ public:
 
 	ofMesh mesh;
 	TreeNode root;
-	bool bUseFaces = false;
 
 	// debug;
 	//
-	int strayVerts= 0;
 	int numLeaf = 0;
+
+private:
+	bool intersect(const Ray &, int nodeIndex, int & leafRtn);
+	void draw(int nodeIndex, int numLevels, int level);
+	void drawLeafNodes(int nodeIndex);
 };
@@ -0,0 +1,1164 @@
+
+//--------------------------------------------------------------
+//
+//  Kevin M. Smith
+//
+//  Simple Octree Implementation 11/10/2020
+// 
+//  Copyright (c) by Kevin M. Smith
+//  Copying or use without permission is prohibited by law. 
+//
+
+
+#include "OctreeCore.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <queue>
+
+using namespace std;
+
+
+// return a Bounding Box for a set of points
+//
+Box OctreeCore::bounds(const Vector3 * points, int n) {
+	if (n == 0) return Box(Vector3(0, 0, 0), Vector3(0, 0, 0));
+	float min[3] = { points[0].x(), points[0].y(), points[0].z() };
+	float max[3] = { min[0], min[1], min[2] };
+	for (int i = 1; i < n; i++) {
+		for (int a = 0; a < 3; a++) {
+			if (points[i][a] > max[a]) max[a] = points[i][a];
+			else if (points[i][a] < min[a]) min[a] = points[i][a];
+		}
+	}
+	return Box(Vector3(min[0], min[1], min[2]), Vector3(max[0], max[1], max[2]));
+}
+
+//  Subdivide a Box into eight(8) equal size boxes, return them in boxes[]
+//  (no allocation - used by the builder)
+//
+void OctreeCore::subDivideBox8(const Box &box, Box b[8]) {
+	Vector3 min = box.parameters[0];
+	Vector3 max = box.parameters[1];
+	Vector3 size = max - min;
+	Vector3 center = size / 2 + min;
+	float xdist = (max.x() - min.x()) / 2;
+	float ydist = (max.y() - min.y()) / 2;
+	float zdist = (max.z() - min.z()) / 2;
+	Vector3 h = Vector3(0, ydist, 0);
+
+	//  generate ground floor
+	//
+	b[0] = Box(min, center);
+	b[1] = Box(b[0].min() + Vector3(xdist, 0, 0), b[0].max() + Vector3(xdist, 0, 0));
+	b[2] = Box(b[1].min() + Vector3(0, 0, zdist), b[1].max() + Vector3(0, 0, zdist));
+	b[3] = Box(b[2].min() + Vector3(-xdist, 0, 0), b[2].max() + Vector3(-xdist, 0, 0));
+
+	// generate second story
+	//
+	for (int i = 4; i < 8; i++) {
+		b[i] = Box(b[i - 4].min() + h, b[i - 4].max() + h);
+	}
+}
+
+//  build the tree over vertices (point mode) or over the triangles given by
+//  indices (face mode, 3 per face; with no indices every 3 vertices form a
+//  face).  The vertices and faces are copied into the Octree's own arrays.
+//
+void OctreeCore::create(const vector<Vector3> & vertices, const vector<int> & indices, int numLevels) {
+	// initialize octree structure
+	//
+	int level = 0;
+	int n = vertices.size();
+
+	cacheFile.close();
+	cacheHash = 0;
+	cacheLevels = 0;
+	vertStore = vertices;
+	faceStore.clear();
+	if (bUseFaces) {
+		if (!indices.empty()) {
+			faceStore.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+		}
+		else {
+			faceStore.resize(n / 3 * 3);
+			for (size_t i = 0; i < faceStore.size(); i++)
+				faceStore[i] = i;
+		}
+	}
+
+	nodeStore.clear();
+	pointStore.clear();
+	bindStorage();
+	strayVerts = 0;
+
+	if (buildType == MortonBuild && !bUseFaces) {
+		createMorton(numLevels);
+		finishBuild();
+		return;
+	}
+	pointStore.reserve(n * 4);
+
+	OctreeNode rootNode;
+	rootNode.box = bounds(verts, numVerts);
+	if (!bUseFaces) {
+		for (int i = 0; i < n; i++) {
+			pointStore.push_back(i);
+		}
+		rootNode.pointCount = n;
+	}
+	else {
+		// load face vertices; points are face indices in this mode
+		//
+		int numFaces = faceStore.size() / 3;
+		for (int i = 0; i < numFaces; i++) {
+			pointStore.push_back(i);
+		}
+		rootNode.pointCount = numFaces;
+	}
+	nodeStore.push_back(rootNode);
+
+	// recursively buid octree
+	//
+	level++;
+	if (bParallel)
+		strayVerts = subdivideParallel(nodeStore, pointStore, numLevels, level);
+	else
+		strayVerts = subdivide(nodeStore, pointStore, 0, numLevels, level);
+	finishBuild();
+}
+
+//  final pass over the pool after any build: set the parent links and pack
+//  the child boxes of every interior node into a Box8 so a ray can be
+//  tested against the whole child block with one batched call
+//
+void OctreeCore::finishBuild() {
+	blockStore.clear();
+	if (!nodeStore.empty()) nodeStore[0].parent = -1;
+	for (size_t i = 0; i < nodeStore.size(); i++) {
+		OctreeNode & node = nodeStore[i];
+		if (node.numChildren == 0) {
+			node.childBlock = -1;
+			continue;
+		}
+		Box8 block;
+		for (int j = 0; j < node.numChildren; j++) {
+			nodeStore[node.firstChild + j].parent = i;
+			block.set(j, nodeStore[node.firstChild + j].box);
+		}
+		node.childBlock = blockStore.size();
+		blockStore.push_back(block);
+	}
+	bindStorage();
+}
+
+//  point the query views at the owned storage
+//
+void OctreeCore::bindStorage() {
+	nodes = nodeStore.data();
+	numNodes = nodeStore.size();
+	pointIndices = pointStore.data();
+	numPointIndices = pointStore.size();
+	verts = vertStore.data();
+	numVerts = vertStore.size();
+	faces = faceStore.data();
+	numFaces = faceStore.size() / 3;
+	childBlocks = blockStore.data();
+	numChildBlocks = blockStore.size();
+}
+
+void OctreeCore::subdivide(int nodeIndex, int numLevels, int level) {
+
+	// a tree loaded from a cache file is read-only; copy it out first
+	//
+	if (cacheFile.isOpen()) {
+		nodeStore.assign(nodes, nodes + numNodes);
+		pointStore.assign(pointIndices, pointIndices + numPointIndices);
+		vertStore.assign(verts, verts + numVerts);
+		faceStore.assign(faces, faces + numFaces * 3);
+		cacheFile.close();
+	}
+	strayVerts += subdivide(nodeStore, pointStore, nodeIndex, numLevels, level);
+	finishBuild();
+}
+
+//  split node into (up to) eight children.  The non-empty children are
+//  appended to the pool as one contiguous block and each child's points
+//  are appended to the point buffer.  Returns the number of stray points
+//  (points, or faces, that went into none of the children).
+//
+int OctreeCore::splitNode(vector<OctreeNode> & pool, vector<int> & points, int nodeIndex) {
+	Box boxList[8];
+	subDivideBox8(pool[nodeIndex].box, boxList);
+	int pointStart = pool[nodeIndex].pointStart;
+	int pointsInNode = pool[nodeIndex].pointCount;
+	int firstChild = pool.size();
+	int numChildren = 0;
+
+	// a point on a split plane or a face across one goes into several
+	// children, so strays are counted per point, not from the totals
+	//
+	static thread_local vector<uint8_t> placed;
+	placed.assign(pointsInNode, 0);
+	for (int i = 0; i < 8; i++) {
+		int childStart = points.size();
+		for (int j = pointStart; j < pointStart + pointsInNode; j++) {
+			int p = points[j];
+			if (bUseFaces ? faceInBox(boxList[i], p) : boxList[i].inside(verts[p])) {
+				points.push_back(p);
+				placed[j - pointStart] = 1;
+			}
+		}
+		int count = points.size() - childStart;
+
+		if (count > 0) {
+			OctreeNode child;
+			child.box = boxList[i];
+			child.pointStart = childStart;
+			child.pointCount = count;
+			pool.push_back(child);
+			numChildren++;
+		}
+	}
+	pool[nodeIndex].firstChild = numChildren > 0 ? firstChild : -1;
+	pool[nodeIndex].numChildren = numChildren;
+
+	// debug
+	//
+	int stray = 0;
+	for (int j = 0; j < pointsInNode; j++)
+		stray += !placed[j];
+	return stray;
+}
+
+//  serial build: split the node, then recursively subdivide each child
+//  (depth first).  Returns the number of stray points.
+//
+int OctreeCore::subdivide(vector<OctreeNode> & pool, vector<int> & points, int nodeIndex, int numLevels, int level) {
+	if (level >= numLevels) return 0;
+	int stray = splitNode(pool, points, nodeIndex);
+	level++;
+	int firstChild = pool[nodeIndex].firstChild;
+	int numChildren = pool[nodeIndex].numChildren;
+	for (int i = firstChild; i < firstChild + numChildren; i++) {
+		if (pool[i].pointCount > leafSize())
+			stray += subdivide(pool, points, i, numLevels, level);
+	}
+	return stray;
+}
+
+//  parallel build of the subtree rooted at pool[0] (whose points are the
+//  first pool[0].pointCount entries of points).  Above parallelDepth each
+//  child subtree is built as a task into its own pool; the child pools are
+//  then spliced back in child order, which gives exactly the layout the
+//  serial depth first build produces.
+//
+int OctreeCore::subdivideParallel(vector<OctreeNode> & pool, vector<int> & points, int numLevels, int level) {
+	if (level > parallelDepth)
+		return subdivide(pool, points, 0, numLevels, level);
+	if (level >= numLevels) return 0;
+
+	int stray = splitNode(pool, points, 0);
+	level++;
+	int firstChild = pool[0].firstChild;
+	int numChildren = pool[0].numChildren;
+
+	vector<OctreeNode> childPool[8];
+	vector<int> childPoints[8];
+	int childStray[8] = { 0 };
+
+	ThreadPool & threads = ThreadPool::shared();
+	TaskGroup group;
+	for (int i = 0; i < numChildren; i++) {
+		const OctreeNode & child = pool[firstChild + i];
+		if (child.pointCount <= leafSize()) continue;
+
+		// child pool: a copy of the child node (re-based to its own
+		// point buffer) which the task then subdivides
+		//
+		OctreeNode base = child;
+		base.pointStart = 0;
+		childPool[i].push_back(base);
+		childPoints[i].assign(points.begin() + child.pointStart,
+			points.begin() + child.pointStart + child.pointCount);
+
+		threads.submit(group, [this, i, numLevels, level, &childPool, &childPoints, &childStray] {
+			childStray[i] = subdivideParallel(childPool[i], childPoints[i], numLevels, level);
+		});
+	}
+	threads.wait(group);
+
+	// splice child pools in order
+	//
+	for (int i = 0; i < numChildren; i++) {
+		if (childPool[i].empty()) continue;
+		vector<OctreeNode> & cp = childPool[i];
+		int baseCount = cp[0].pointCount;
+		int nodeOffset = pool.size() - 1;
+		int pointOffset = points.size() - baseCount;
+
+		pool[firstChild + i].firstChild = cp[0].firstChild < 0 ? -1 : cp[0].firstChild + nodeOffset;
+		pool[firstChild + i].numChildren = cp[0].numChildren;
+		for (size_t j = 1; j < cp.size(); j++) {
+			OctreeNode n = cp[j];
+			if (n.firstChild >= 0) n.firstChild += nodeOffset;
+			n.pointStart += pointOffset;
+			pool.push_back(n);
+		}
+		points.insert(points.end(), childPoints[i].begin() + baseCount, childPoints[i].end());
+		stray += childStray[i];
+	}
+	return stray;
+}
+
+//  Morton (Z-order) build.
+//
+//  Each vertex is quantized to 21 bits per axis inside the mesh bounds and
+//  the bits are interleaved into a 63-bit code.  After a radix sort the
+//  points of every octree cell are a contiguous run of codes sharing the
+//  same prefix, so pointIndices is simply the sorted index list and each
+//  node's point range is a view into it (no per level copies).  Children
+//  are found by binary searching the next 3 bit digit of the run.
+//
+//  Unlike the top-down build a vertex that lies exactly on a split plane
+//  lands in a single cell instead of in every cell that touches it.
+//
+static const int mortonBits = 21;
+
+// spread the low 21 bits of v so there are two zero bits between each
+//
+static uint64_t mortonSpread(uint64_t v) {
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffULL;
+	v = (v | v << 16) & 0x1f0000ff0000ffULL;
+	v = (v | v << 8) & 0x100f00f00f00f00fULL;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+	v = (v | v << 2) & 0x1249249249249249ULL;
+	return v;
+}
+
+// octant digit (x << 2 | y << 1 | z) of the child at subDivideBox8() slot
+//
+static const int mortonDigit[8] = { 0, 4, 5, 1, 2, 6, 7, 3 };
+
+// LSD radix sort of (code, index) pairs, 8 bits per pass.  Passes where
+// every key has the same digit are skipped.
+//
+static void mortonSort(vector<uint64_t> & codes, vector<int> & index) {
+	int n = codes.size();
+	vector<uint64_t> codesTmp(n);
+	vector<int> indexTmp(n);
+	for (int shift = 0; shift < 64; shift += 8) {
+		int count[257] = { 0 };
+		for (int i = 0; i < n; i++)
+			count[((codes[i] >> shift) & 0xff) + 1]++;
+		bool trivial = false;
+		for (int b = 1; b <= 256; b++) {
+			if (count[b] == n) trivial = true;
+			count[b] += count[b - 1];
+		}
+		if (trivial) continue;
+		for (int i = 0; i < n; i++) {
+			int dst = count[(codes[i] >> shift) & 0xff]++;
+			codesTmp[dst] = codes[i];
+			indexTmp[dst] = index[i];
+		}
+		codes.swap(codesTmp);
+		index.swap(indexTmp);
+	}
+}
+
+void OctreeCore::createMorton(int numLevels) {
+	int n = numVerts;
+	OctreeNode rootNode;
+	rootNode.box = bounds(verts, numVerts);
+	rootNode.pointCount = n;
+
+	// quantize and encode
+	//
+	Vector3 min = rootNode.box.min();
+	Vector3 size = rootNode.box.max() - min;
+	float cells = (float)(1 << mortonBits);
+	float scale[3];
+	for (int a = 0; a < 3; a++)
+		scale[a] = size[a] > 0 ? cells / size[a] : 0;
+
+	vector<uint64_t> codes(n);
+	pointStore.resize(n);
+	for (int i = 0; i < n; i++) {
+		uint64_t q[3];
+		for (int a = 0; a < 3; a++) {
+			float f = (verts[i][a] - min[a]) * scale[a];
+			q[a] = f <= 0 ? 0 : (f >= cells ? (1 << mortonBits) - 1 : (uint64_t)f);
+		}
+		codes[i] = (mortonSpread(q[0]) << 2) | (mortonSpread(q[1]) << 1) | mortonSpread(q[2]);
+		pointStore[i] = i;
+	}
+	mortonSort(codes, pointStore);
+
+	nodeStore.push_back(rootNode);
+	subdivideMorton(codes, 0, numLevels, 1);
+}
+
+void OctreeCore::subdivideMorton(const vector<uint64_t> & codes, int nodeIndex, int numLevels, int level) {
+	if (level >= numLevels || level > mortonBits) return;
+	Box boxList[8];
+	subDivideBox8(nodeStore[nodeIndex].box, boxList);
+	int shift = 3 * (mortonBits - level);
+	int begin = nodeStore[nodeIndex].pointStart;
+	int end = begin + nodeStore[nodeIndex].pointCount;
+	level++;
+
+	// locate the run of each octant digit; digits are sorted within the node
+	//
+	int runStart[9];
+	for (int d = 0; d <= 8; d++) {
+		runStart[d] = std::partition_point(codes.begin() + begin, codes.begin() + end,
+			[shift, d](uint64_t c) { return (int)((c >> shift) & 7) < d; }) - codes.begin();
+	}
+
+	int firstChild = nodeStore.size();
+	int numChildren = 0;
+	for (int i = 0; i < 8; i++) {
+		int d = mortonDigit[i];
+		int count = runStart[d + 1] - runStart[d];
+		if (count > 0) {
+			OctreeNode child;
+			child.box = boxList[i];
+			child.pointStart = runStart[d];
+			child.pointCount = count;
+			nodeStore.push_back(child);
+			numChildren++;
+		}
+	}
+	nodeStore[nodeIndex].firstChild = numChildren > 0 ? firstChild : -1;
+	nodeStore[nodeIndex].numChildren = numChildren;
+
+	for (int i = firstChild; i < firstChild + numChildren; i++) {
+		if (nodeStore[i].pointCount > 1)
+			subdivideMorton(codes, i, numLevels, level);
+	}
+}
+
+//  closest hit along the ray in [0, tMax].  Children are visited front to
+//  back by the distance at which the ray enters their box, and any child
+//  entered beyond the best hit so far is skipped.  A point leaf counts as
+//  hit at its box entry distance; the point returned is the leaf point
+//  nearest the ray origin.  In face mode the hit is the exact ray-triangle
+//  intersection.
+//
+bool OctreeCore::closestHit(const Ray &ray, OctreeHit & hit, float tMax) const {
+	hit = OctreeHit();
+	hit.t = tMax;
+	if (numNodes == 0) return false;
+	float tNear, tFar;
+	if (!nodes[0].box.intersect(ray, 0, tMax, tNear, tFar)) return false;
+	closestHit(ray, 0, tNear, hit);
+	return hit.node >= 0;
+}
+
+//  closest hit test against the points / faces of one leaf
+//
+void OctreeCore::leafHit(const Ray &ray, int nodeIndex, float tNear, OctreeHit & hit) const {
+	const OctreeNode & node = nodes[nodeIndex];
+	if (node.pointCount == 0 || tNear >= hit.t) return;
+	if (bUseFaces) {
+
+		// exact ray-triangle test against the faces in the leaf
+		//
+		for (int i = node.pointStart; i < node.pointStart + node.pointCount; i++) {
+			int f = pointIndices[i];
+			float t;
+			if (ray.intersectTriangle(verts[faces[f * 3]], verts[faces[f * 3 + 1]],
+				verts[faces[f * 3 + 2]], 0, hit.t, t)) {
+				hit.t = t;
+				hit.index = f;
+				hit.node = nodeIndex;
+				hit.point = ray.origin + ray.direction * t;
+			}
+		}
+		return;
+	}
+	float best = FLT_MAX;
+	for (int i = node.pointStart; i < node.pointStart + node.pointCount; i++) {
+		const Vector3 & p = verts[pointIndices[i]];
+		float d = (p - ray.origin) * ray.direction;
+		if (d < best) {
+			best = d;
+			hit.index = pointIndices[i];
+			hit.point = p;
+		}
+	}
+	hit.t = tNear;
+	hit.node = nodeIndex;
+}
+
+void OctreeCore::closestHit(const Ray &ray, int nodeIndex, float tNear, OctreeHit & hit) const {
+	const OctreeNode & node = nodes[nodeIndex];
+	if (node.numChildren == 0) {
+		leafHit(ray, nodeIndex, tNear, hit);
+		return;
+	}
+
+	// test the ray against the whole child block at once, then sort the
+	// children it enters by entry distance (at most 8, so insertion sort)
+	//
+	float tNear8[8];
+	int mask = intersect8(ray, childBlocks[node.childBlock], 0, hit.t, tNear8);
+	float entry[8];
+	int order[8];
+	int n = 0;
+	for (int c = 0; c < node.numChildren; c++) {
+		if (!(mask & (1 << c))) continue;
+		float t0 = tNear8[c];
+		int j = n++;
+		while (j > 0 && entry[j - 1] > t0) {
+			entry[j] = entry[j - 1];
+			order[j] = order[j - 1];
+			j--;
+		}
+		entry[j] = t0;
+		order[j] = node.firstChild + c;
+	}
+	for (int i = 0; i < n; i++) {
+		if (entry[i] >= hit.t) break;      // everything after is farther
+		closestHit(ray, order[i], entry[i], hit);
+	}
+}
+
+//  closest hit for many rays at once.  Rays are traversed in packets of 8
+//  (consecutive rays, so callers should pass coherent rays next to each
+//  other); each packet walks the tree once, testing all its live rays
+//  against a child box with one batched call.  Large batches are split
+//  across the shared ThreadPool.  Returns the number of rays that hit.
+//
+int OctreeCore::closestHits(const vector<Ray> & rays, vector<OctreeHit> & hits, float tMax) const {
+	hits.resize(rays.size());
+	if (rays.empty()) return 0;
+	return closestHits(&rays[0], rays.size(), &hits[0], tMax);
+}
+
+int OctreeCore::closestHits(const Ray * rays, int numRays, OctreeHit * hits, float tMax) const {
+	const int chunkSize = 256;
+	if (numRays < 2 * chunkSize) {
+		closestHitPackets(rays, numRays, hits, tMax);
+	}
+	else {
+		ThreadPool & threads = ThreadPool::shared();
+		TaskGroup group;
+		for (int i = 0; i < numRays; i += chunkSize) {
+			int count = std::min(chunkSize, numRays - i);
+			threads.submit(group, [this, rays, hits, i, count, tMax] {
+				closestHitPackets(rays + i, count, hits + i, tMax);
+			});
+		}
+		threads.wait(group);
+	}
+
+	int numHits = 0;
+	for (int i = 0; i < numRays; i++)
+		if (hits[i].node >= 0) numHits++;
+	return numHits;
+}
+
+void OctreeCore::closestHitPackets(const Ray * rays, int numRays, OctreeHit * hits, float tMax) const {
+	for (int p = 0; p < numRays; p += 8) {
+		int count = std::min(8, numRays - p);
+		Ray8 packet;
+		float t1[8], tNear[8];
+		for (int r = 0; r < 8; r++) t1[r] = tMax;
+		for (int r = 0; r < count; r++) {
+			packet.set(r, rays[p + r]);
+			hits[p + r] = OctreeHit();
+			hits[p + r].t = tMax;
+		}
+		if (numNodes == 0) continue;
+		int active = intersect8(packet, nodes[0].box, 0, t1, tNear);
+		if (active)
+			closestHitPacket(rays + p, packet, 0, active, tNear, hits + p);
+	}
+}
+
+void OctreeCore::closestHitPacket(const Ray * rays, const Ray8 & packet, int nodeIndex, int active,
+	const float tNear[8], OctreeHit * hits) const {
+	const OctreeNode & node = nodes[nodeIndex];
+	if (node.numChildren == 0) {
+		for (int r = 0; r < packet.count; r++)
+			if (active & (1 << r)) leafHit(rays[r], nodeIndex, tNear[r], hits[r]);
+		return;
+	}
+
+	// once the packet has diverged to a single ray use the single ray path
+	//
+	if ((active & (active - 1)) == 0) {
+		int r = 0;
+		while (!(active & (1 << r))) r++;
+		closestHit(rays[r], nodeIndex, tNear[r], hits[r]);
+		return;
+	}
+
+	// test the live rays against each child, then visit the children in
+	// order of the nearest entry over the packet
+	//
+	float tBest[8];
+	for (int r = 0; r < 8; r++)
+		tBest[r] = r < packet.count ? hits[r].t : 0;
+	float childNear[8][8];
+	int childMask[8];
+	float key[8];
+	int order[8];
+	int n = 0;
+	for (int c = 0; c < node.numChildren; c++) {
+		childMask[c] = intersect8(packet, nodes[node.firstChild + c].box, 0, tBest, childNear[c]) & active;
+		if (!childMask[c]) continue;
+		float k = FLT_MAX;
+		for (int r = 0; r < packet.count; r++)
+			if ((childMask[c] & (1 << r)) && childNear[c][r] < k) k = childNear[c][r];
+		int j = n++;
+		while (j > 0 && key[j - 1] > k) {
+			key[j] = key[j - 1];
+			order[j] = order[j - 1];
+			j--;
+		}
+		key[j] = k;
+		order[j] = c;
+	}
+	for (int i = 0; i < n; i++) {
+		int c = order[i];
+
+		// drop rays that found a closer hit while visiting earlier children
+		//
+		int mask = childMask[c];
+		for (int r = 0; r < packet.count; r++)
+			if ((mask & (1 << r)) && childNear[c][r] >= hits[r].t) mask &= ~(1 << r);
+		if (mask)
+			closestHitPacket(rays, packet, node.firstChild + c, mask, childNear[c], hits);
+	}
+}
+
+//  box query starting at any node; also returns the leaf node indices hit
+//
+bool OctreeCore::intersect(const Box &box, int nodeIndex, vector<Box> & boxListRtn, vector<int> & leafListRtn) const {
+	if (nodeIndex < 0 || nodeIndex >= numNodes) return false;
+	return intersectNode(box, nodeIndex, boxListRtn, &leafListRtn);
+}
+
+bool OctreeCore::intersectNode(const Box &box, int nodeIndex, vector<Box> & boxListRtn, vector<int> * leafListRtn) const {
+	bool intersects = false;
+	const OctreeNode & node = nodes[nodeIndex];
+    if(node.box.overlap(box)) {
+        if(node.pointCount == 0)
+            intersects = false;
+        else if(node.numChildren == 0) {
+            boxListRtn.push_back(node.box);     //push box to list if intersect box
+            if(leafListRtn) leafListRtn->push_back(nodeIndex);
+            intersects = true;
+        }
+        else {
+            for(int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+                if(intersectNode(box, i, boxListRtn, leafListRtn))
+                    intersects = true;
+            }
+        }
+    }
+	return intersects;
+}
+
+//  true if inner lies strictly inside outer (not touching its faces)
+//
+static bool encloses(const Box &outer, const Box &inner) {
+	for (int a = 0; a < 3; a++) {
+		if (inner.parameters[0][a] <= outer.parameters[0][a] ||
+			inner.parameters[1][a] >= outer.parameters[1][a])
+			return false;
+	}
+	return true;
+}
+
+//  deepest node whose box strictly encloses box, searching from startNode:
+//  climb until the node encloses the box (or the root is reached), then
+//  descend while one of the children encloses it.  Since the children of a
+//  node tile its box, no leaf outside the returned node can overlap box.
+//
+int OctreeCore::findEnclosingNode(const Box &box, int startNode) const {
+	if (numNodes == 0) return -1;
+	int n = (startNode >= 0 && startNode < numNodes) ? startNode : 0;
+	while (n > 0 && !encloses(nodes[n].box, box))
+		n = nodes[n].parent;
+
+	bool descend = encloses(nodes[n].box, box);
+	while (descend) {
+		descend = false;
+		const OctreeNode & node = nodes[n];
+		for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+			if (encloses(nodes[i].box, box)) {
+				n = i;
+				descend = true;
+				break;
+			}
+		}
+	}
+	return n;
+}
+
+//  squared distance from p to the nearest point of box (0 inside)
+//
+static float boxDistance2(const Box &box, const Vector3 &p) {
+	float d2 = 0;
+	for (int a = 0; a < 3; a++) {
+		float d = fmaxf(box.parameters[0][a] - p[a], p[a] - box.parameters[1][a]);
+		if (d > 0) d2 += d * d;
+	}
+	return d2;
+}
+
+static bool closerNeighbor(const OctreeNeighbor &a, const OctreeNeighbor &b) {
+	return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+}
+
+//  closest first; duplicates (points on shared box faces) end up side by
+//  side and are dropped.  Distances go in squared.
+//
+static int sortUnique(vector<OctreeNeighbor> & result) {
+	sort(result.begin(), result.end(), closerNeighbor);
+	int numUnique = 0;
+	for (size_t i = 0; i < result.size(); i++) {
+		if (numUnique > 0 && result[numUnique - 1].index == result[i].index) continue;
+		result[numUnique] = result[i];
+		result[numUnique].distance = sqrtf(result[i].distance);
+		numUnique++;
+	}
+	result.resize(numUnique);
+	return numUnique;
+}
+
+//  k nearest points, best first: open nodes wait in a priority queue
+//  keyed by the distance to their box, and the k best points so far are
+//  a max heap in result.  The search ends when the nearest open box is
+//  farther than the k-th best point, so only the leaves around p are
+//  opened.  A point on a box face is stored in both leaves, hence the
+//  duplicate check.  Distances are squared until the end.
+//
+int OctreeCore::nearest(const Vector3 &p, int k, vector<OctreeNeighbor> & result, float maxDistance) const {
+	result.clear();
+	if (numNodes == 0 || k <= 0 || bUseFaces) return 0;
+	float limit = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	typedef pair<float, int> OpenNode;
+	priority_queue<OpenNode, vector<OpenNode>, greater<OpenNode> > open;
+	float d0 = boxDistance2(nodes[0].box, p);
+	if (d0 <= limit) open.push(OpenNode(d0, 0));
+	while (!open.empty()) {
+		OpenNode top = open.top();
+		open.pop();
+		float bound = (int)result.size() == k ? result.front().distance : limit;
+		if (top.first > bound) break;
+		const OctreeNode & node = nodes[top.second];
+		if (node.numChildren > 0) {
+			for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+				float d = boxDistance2(nodes[i].box, p);
+				if (d <= bound) open.push(OpenNode(d, i));
+			}
+			continue;
+		}
+		for (int i = node.pointStart; i < node.pointStart + node.pointCount; i++) {
+			OctreeNeighbor n;
+			n.index = pointIndices[i];
+			n.point = verts[n.index];
+			n.distance = (n.point - p) * (n.point - p);
+			n.node = top.second;
+			if (n.distance > limit || ((int)result.size() == k && !closerNeighbor(n, result.front()))) continue;
+			bool seen = false;
+			for (size_t j = 0; j < result.size() && !seen; j++)
+				seen = result[j].index == n.index;
+			if (seen) continue;
+			if ((int)result.size() == k) {
+				pop_heap(result.begin(), result.end(), closerNeighbor);
+				result.pop_back();
+			}
+			result.push_back(n);
+			push_heap(result.begin(), result.end(), closerNeighbor);
+		}
+	}
+	sort_heap(result.begin(), result.end(), closerNeighbor);
+	for (size_t i = 0; i < result.size(); i++)
+		result[i].distance = sqrtf(result[i].distance);
+	return result.size();
+}
+
+//  all points within radius: descend only into boxes within radius of p
+//
+int OctreeCore::withinRadius(const Vector3 &p, float radius, vector<OctreeNeighbor> & result) const {
+	result.clear();
+	if (numNodes == 0 || !(radius >= 0) || bUseFaces) return 0;
+	float r2 = radius * radius;
+	vector<int> stack;
+	if (boxDistance2(nodes[0].box, p) <= r2) stack.push_back(0);
+	while (!stack.empty()) {
+		int n = stack.back();
+		stack.pop_back();
+		const OctreeNode & node = nodes[n];
+		if (node.numChildren > 0) {
+			for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+				if (boxDistance2(nodes[i].box, p) <= r2) stack.push_back(i);
+			}
+			continue;
+		}
+		for (int i = node.pointStart; i < node.pointStart + node.pointCount; i++) {
+			const Vector3 & q = verts[pointIndices[i]];
+			float d2 = (q - p) * (q - p);
+			if (d2 > r2) continue;
+			OctreeNeighbor neighbor;
+			neighbor.point = q;
+			neighbor.distance = d2;
+			neighbor.node = n;
+			neighbor.index = pointIndices[i];
+			result.push_back(neighbor);
+		}
+	}
+	return sortUnique(result);
+}
+
+//  all points in the cone around ray: a node is opened when its bounding
+//  sphere reaches into the cone, i.e. when the sphere center's distance
+//  from the axis, less the sphere radius, is within the cone's radius at
+//  the far side of the sphere.  The ray direction is unit length (as a
+//  pick ray's is); distances are from the ray origin.
+//
+int OctreeCore::withinCone(const Ray &ray, float slope, vector<OctreeNeighbor> & result) const {
+	result.clear();
+	if (numNodes == 0 || !(slope >= 0) || bUseFaces) return 0;
+	const Vector3 & dir = ray.direction;
+	vector<int> stack;
+	stack.push_back(0);
+	while (!stack.empty()) {
+		int n = stack.back();
+		stack.pop_back();
+		const OctreeNode & node = nodes[n];
+		Vector3 v = node.box.center() - ray.origin;
+		float h = (node.box.max() - node.box.min()).length() * 0.5f;
+		float t = v * dir;
+		Vector3 off = v - dir * t;
+		if (t + h < 0 || off.length() - h > slope * (t + h)) continue;
+		if (node.numChildren > 0) {
+			for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++)
+				stack.push_back(i);
+			continue;
+		}
+		for (int i = node.pointStart; i < node.pointStart + node.pointCount; i++) {
+			const Vector3 & q = verts[pointIndices[i]];
+			Vector3 w = q - ray.origin;
+			float tq = w * dir;
+			Vector3 off = w - dir * tq;
+			if (tq < 0 || off * off > slope * slope * tq * tq) continue;
+			OctreeNeighbor neighbor;
+			neighbor.point = q;
+			neighbor.distance = w * w;
+			neighbor.node = n;
+			neighbor.index = pointIndices[i];
+			result.push_back(neighbor);
+		}
+	}
+	return sortUnique(result);
+}
+
+//--------------------------------------------------------------
+//  OctreeCollisionQuery
+//
+
+//  bounds of box over its whole path as it is moved by motion
+//
+static Box sweptBounds(const Box &box, const Vector3 &motion) {
+	Box end = Box(box.min() + motion, box.max() + motion);
+	return Box(Vector3(fminf(box.min().x(), end.min().x()), fminf(box.min().y(), end.min().y()),
+			fminf(box.min().z(), end.min().z())),
+		Vector3(fmaxf(box.max().x(), end.max().x()), fmaxf(box.max().y(), end.max().y()),
+			fmaxf(box.max().z(), end.max().z())));
+}
+
+void OctreeCollisionQuery::setOctree(const OctreeCore *tree) {
+	octree = tree;
+	startNode = 0;
+	boxes.clear();
+	leaves.clear();
+}
+
+//  collide box against the octree; leaf boxes hit are returned in boxes
+//  (and their node indices in leaves), both cleared on every call
+//
+bool OctreeCollisionQuery::query(const Box &box) {
+	boxes.clear();
+	leaves.clear();
+	if (octree == NULL || octree->numNodes == 0) return false;
+	startNode = octree->findEnclosingNode(box, startNode);
+	return octree->intersect(box, startNode, boxes, leaves);
+}
+
+//  box moved by motion against the leaf boxes along its path: the earliest
+//  time of impact t (0 .. 1 of motion) and the face of the leaf box it
+//  meets; false if it meets none
+//
+bool OctreeCollisionQuery::sweep(const Box &box, const Vector3 &motion, float &t, Vector3 &normal) {
+	if (!query(sweptBounds(box, motion))) return false;
+	bool hit = false;
+	t = 1;
+	for (size_t i = 0; i < boxes.size(); i++) {
+		float ti;
+		Vector3 ni;
+		if (box.sweep(motion, boxes[i], ti, ni) && ti <= t) {
+			t = ti;
+			normal = ni;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+//--------------------------------------------------------------
+//  OctreeContactQuery
+//
+void OctreeContactQuery::setOctree(const OctreeCore *tree) {
+	octree = (tree && tree->bUseFaces) ? tree : NULL;
+	startNode = 0;
+	contacts.clear();
+	boxes.clear();
+}
+
+//  candidates: the triangles in the leaves under bounds (a triangle stored
+//  in several leaves once) whose own bounds overlap it; most triangles are
+//  rejected here, before the full separating axis test
+//
+bool OctreeContactQuery::gather(const Box &bounds) {
+	boxes.clear();
+	leaves.clear();
+	candidates.clear();
+	if (octree == NULL || octree->numNodes == 0) return false;
+	startNode = octree->findEnclosingNode(bounds, startNode);
+	if (!octree->intersect(bounds, startNode, boxes, leaves)) return false;
+
+	for (size_t i = 0; i < leaves.size(); i++) {
+		const OctreeNode & node = octree->nodes[leaves[i]];
+		for (int k = node.pointStart; k < node.pointStart + node.pointCount; k++)
+			candidates.push_back(octree->pointIndices[k]);
+	}
+	sort(candidates.begin(), candidates.end());
+	candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+	int kept = 0;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const int *tri = octree->faces + candidates[i] * 3;
+		const Vector3 &a = octree->verts[tri[0]], &b = octree->verts[tri[1]], &c = octree->verts[tri[2]];
+		bool outside = false;
+		for (int k = 0; k < 3 && !outside; k++) {
+			float lo = fminf(a[k], fminf(b[k], c[k]));
+			float hi = fmaxf(a[k], fmaxf(b[k], c[k]));
+			outside = lo > bounds.parameters[1][k] || hi < bounds.parameters[0][k];
+		}
+		if (!outside) candidates[kept++] = candidates[i];
+	}
+	candidates.resize(kept);
+	return kept > 0;
+}
+
+//  contacts of box with the triangles in the leaves it overlaps; returns
+//  the count
+//
+int OctreeContactQuery::query(const Obb &box) {
+	contacts.clear();
+	Box bounds = box.bounds();
+	if (!gather(bounds)) return 0;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		int f = candidates[i];
+		const int *tri = octree->faces + f * 3;
+		const Vector3 &a = octree->verts[tri[0]], &b = octree->verts[tri[1]], &c3 = octree->verts[tri[2]];
+		OctreeContact c;
+		if (box.contact(a, b, c3, c.normal, c.depth, c.point)) {
+			c.face = f;
+			contacts.push_back(c);
+		}
+	}
+	return contacts.size();
+}
+
+//  box moved by motion against the triangles along its path (the leaves
+//  under its swept bounds): the earliest time of impact t (0 .. 1 of
+//  motion) and the normal it meets; false if it meets none.  A triangle
+//  the box already overlaps and moves into stops it at t = 0 (see
+//  Box::sweep()); one it moves away from is left to query().
+//
+bool OctreeContactQuery::sweep(const Obb &box, const Vector3 &motion, float &t, Vector3 &normal) {
+	if (!gather(sweptBounds(box.bounds(), motion))) return false;
+	bool hit = false;
+	t = 1;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const int *tri = octree->faces + candidates[i] * 3;
+		float ti;
+		Vector3 ni;
+		if (box.sweep(motion, octree->verts[tri[0]], octree->verts[tri[1]], octree->verts[tri[2]], ti, ni) &&
+			ti <= t) {
+			t = ti;
+			normal = ni;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+//--------------------------------------------------------------
+//  Octree cache file
+//
+//  A versioned binary image of the built tree: header, then the node pool,
+//  point index buffer, vertex positions, faces and child blocks, each
+//  aligned to 64 bytes.  load() maps the file and points the query views
+//  straight at it, so nothing is parsed or allocated per node.  The header
+//  records the mesh content hash, level count and build options; a cache
+//  that doesn't match is ignored and rebuilt.
+//
+static const char cacheMagic[8] = { 'O', 'C', 'T', 'R', 'E', 'E', 0, 0 };
+static const uint32_t cacheVersion = 2;
+static const uint32_t cacheByteOrder = 0x01020304;
+
+class OctreeCacheHeader {
+public:
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t nodeSize;              // sizeof(OctreeNode), sizeof(Box8) guard
+	uint32_t blockSize;             // against layout changes
+	uint64_t meshHash;
+	int32_t numLevels;
+	int32_t useFaces;
+	int32_t maxLeafFaces;
+	int32_t buildType;
+	int32_t count[5];               // nodes, point indices, verts, face ints, blocks
+	uint64_t offset[5];
+};
+
+static uint64_t cacheAlign(uint64_t n) {
+	return (n + 63) & ~(uint64_t)63;
+}
+
+//  64-bit FNV-1a hash of the mesh vertex positions and indices
+//
+static uint64_t fnv1a(uint64_t h, const void *data, size_t n) {
+	const unsigned char *p = (const unsigned char *)data;
+	for (size_t i = 0; i < n; i++)
+		h = (h ^ p[i]) * 1099511628211ULL;
+	return h;
+}
+
+uint64_t OctreeCore::meshHash(const vector<Vector3> & vertices, const vector<int> & indices) {
+	uint64_t h = 14695981039346656037ULL;
+	if (!vertices.empty())
+		h = fnv1a(h, &vertices[0], vertices.size() * sizeof(Vector3));
+	if (!indices.empty())
+		h = fnv1a(h, &indices[0], indices.size() * sizeof(int));
+	return h;
+}
+
+bool OctreeCore::save(const string & path, uint64_t hash, int numLevels) const {
+	OctreeCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.byteOrder = cacheByteOrder;
+	header.nodeSize = sizeof(OctreeNode);
+	header.blockSize = sizeof(Box8);
+	header.meshHash = hash;
+	header.numLevels = numLevels;
+	header.useFaces = bUseFaces;
+	header.maxLeafFaces = maxLeafFaces;
+	header.buildType = buildType;
+
+	const void *data[5] = { nodes, pointIndices, verts, faces, childBlocks };
+	size_t bytes[5] = { numNodes * sizeof(OctreeNode), numPointIndices * sizeof(int),
+		numVerts * sizeof(Vector3), numFaces * 3 * sizeof(int), numChildBlocks * sizeof(Box8) };
+	int count[5] = { numNodes, numPointIndices, numVerts, numFaces * 3, numChildBlocks };
+	uint64_t pos = cacheAlign(sizeof(header));
+	for (int i = 0; i < 5; i++) {
+		header.count[i] = count[i];
+		header.offset[i] = pos;
+		pos = cacheAlign(pos + bytes[i]);
+	}
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (f == NULL) return false;
+	static const char zeros[64] = { 0 };
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	uint64_t written = sizeof(header);
+	for (int i = 0; i < 5 && ok; i++) {
+		ok = fwrite(zeros, 1, header.offset[i] - written, f) == header.offset[i] - written;
+		if (ok && bytes[i] > 0)
+			ok = fwrite(data[i], 1, bytes[i], f) == bytes[i];
+		written = header.offset[i] + bytes[i];
+	}
+	ok = fclose(f) == 0 && ok;
+	if (!ok) remove(path.c_str());
+	return ok;
+}
+
+bool OctreeCore::load(const string & path, uint64_t hash, int numLevels) {
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(OctreeCacheHeader)) return false;
+
+	OctreeCacheHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+		header.version != cacheVersion || header.byteOrder != cacheByteOrder ||
+		header.nodeSize != sizeof(OctreeNode) || header.blockSize != sizeof(Box8) ||
+		header.meshHash != hash || header.numLevels != numLevels ||
+		header.useFaces != bUseFaces || header.buildType != buildType ||
+		(bUseFaces && header.maxLeafFaces != maxLeafFaces))
+		return false;
+
+	size_t elemSize[5] = { sizeof(OctreeNode), sizeof(int), sizeof(Vector3), sizeof(int), sizeof(Box8) };
+	for (int i = 0; i < 5; i++) {
+		if (header.count[i] < 0 || header.offset[i] % 64 != 0 ||
+			header.offset[i] + (uint64_t)header.count[i] * elemSize[i] > file.size())
+			return false;
+	}
+	if (header.count[0] == 0) return false;
+
+	// use the mapping in place
+	//
+	nodeStore.clear();
+	pointStore.clear();
+	vertStore.clear();
+	faceStore.clear();
+	blockStore.clear();
+	cacheFile.swap(file);
+	cacheHash = hash;
+	cacheLevels = numLevels;
+
+	const char *base = cacheFile.data();
+	nodes = (const OctreeNode *)(base + header.offset[0]);
+	numNodes = header.count[0];
+	pointIndices = (const int *)(base + header.offset[1]);
+	numPointIndices = header.count[1];
+	verts = (const Vector3 *)(base + header.offset[2]);
+	numVerts = header.count[2];
+	faces = (const int *)(base + header.offset[3]);
+	numFaces = header.count[3] / 3;
+	childBlocks = (const Box8 *)(base + header.offset[4]);
+	numChildBlocks = header.count[4];
+
+	strayVerts = 0;
+	return true;
+}
+
+//  create the octree, reusing the cache file at cachePath when it matches
+//  the mesh and settings, and (re)writing it otherwise.  Returns true if
+//  the tree came from the cache.
+//
+bool OctreeCore::createCached(const vector<Vector3> & vertices, const vector<int> & indices,
+	int numLevels, const string & cachePath) {
+	uint64_t hash = meshHash(vertices, indices);
+	if (load(cachePath, hash, numLevels))
+		return true;
+	create(vertices, indices, numLevels);
+	cacheHash = hash;
+	cacheLevels = numLevels;
+	if (!save(cachePath, hash, numLevels))
+		cout << "Unable to write octree cache " << cachePath << endl;
+	return false;
+}
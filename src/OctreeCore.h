@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "box.h"
+#include "ray.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+
+//  OctreeCore - the octree build, storage and queries with no
+//  openFrameworks dependency, so the simulation can run headless.  The
+//  tree is built from plain vertex positions and triangle indices; the
+//  Octree class (Octree.h) wraps it for ofMesh input and drawing.
+//
+
+//  OctreeNode - one entry in the Octree's contiguous node pool.  The
+//  children of a node are stored back to back starting at firstChild and
+//  the node's points are the range [pointStart, pointStart + pointCount)
+//  of the shared Octree::pointIndices buffer.
+//
+class OctreeNode {
+public:
+	Box box;
+	int firstChild = -1;        // index of first child in pool (-1 = leaf)
+	int numChildren = 0;
+	int pointStart = 0;         // first entry in pointIndices
+	int pointCount = 0;
+	int childBlock = -1;        // index of child boxes in Octree::childBlocks
+	int parent = -1;
+};
+
+//  OctreeHit - result of a closest hit ray query
+//
+class OctreeHit {
+public:
+	Vector3 point;              // hit point
+	float t = 0;                // distance along the ray
+	int node = -1;              // leaf node index in Octree::nodes
+	int index = -1;             // mesh point (or face) index
+};
+
+//  OctreeNeighbor - one result of a nearest point or radius query
+//
+class OctreeNeighbor {
+public:
+	Vector3 point;              // mesh point
+	float distance = 0;         // from the query point
+	int node = -1;              // leaf node index in Octree::nodes
+	int index = -1;             // mesh point index
+};
+
+//  construction method: TopDownBuild rescans each node's points against its
+//  eight child boxes; MortonBuild sorts the points by Z-order (Morton) code
+//  and reads the hierarchy straight off the sorted codes.
+//
+typedef enum { TopDownBuild, MortonBuild } OctreeBuildType;
+
+class OctreeCore {
+public:
+
+	// indices: 3 per triangle (face mode only; empty = every 3 vertices)
+	//
+	void create(const std::vector<Vector3> & vertices, const std::vector<int> & indices, int numLevels);
+	bool createCached(const std::vector<Vector3> & vertices, const std::vector<int> & indices,
+		int numLevels, const std::string & cachePath);
+	bool save(const std::string & path, uint64_t meshHash, int numLevels) const;
+	bool load(const std::string & path, uint64_t meshHash, int numLevels);
+	static uint64_t meshHash(const std::vector<Vector3> & vertices, const std::vector<int> & indices);
+	void subdivide(int nodeIndex, int numLevels, int level);
+	bool intersect(const Box &, int nodeIndex, std::vector<Box> & boxListRtn, std::vector<int> & leafListRtn) const;
+	int findEnclosingNode(const Box &, int startNode) const;
+	bool closestHit(const Ray &, OctreeHit & hit, float tMax = FLT_MAX) const;
+	int closestHits(const std::vector<Ray> & rays, std::vector<OctreeHit> & hits, float tMax = FLT_MAX) const;
+	int closestHits(const Ray * rays, int numRays, OctreeHit * hits, float tMax = FLT_MAX) const;
+	static Box bounds(const Vector3 * points, int numPoints);
+
+	// point mode: the k mesh points nearest p, all points within radius of
+	// p, or all points in the cone around ray (within slope * t of it at t
+	// along it, e.g. the pixels around a pick ray), closest to p or to the
+	// ray origin first (face mode returns none).  Returns the count.
+	// Only points in a leaf are found, so build with MortonBuild, which
+	// places every point; TopDownBuild can leave some out (strayVerts).
+	//
+	int nearest(const Vector3 & p, int k, std::vector<OctreeNeighbor> & result, float maxDistance = FLT_MAX) const;
+	int withinRadius(const Vector3 & p, float radius, std::vector<OctreeNeighbor> & result) const;
+	int withinCone(const Ray & ray, float slope, std::vector<OctreeNeighbor> & result) const;
+	static void subDivideBox8(const Box &b, Box boxes[8]);
+
+	// face mode: leaves hold triangles (face indices) instead of points.
+	// A triangle is stored in every leaf it overlaps, and nodes with
+	// maxLeafFaces or fewer triangles are not split further.
+	//
+	bool bUseFaces = false;
+	int maxLeafFaces = 8;
+
+	// build options: bParallel subdivides the tree with tasks on the shared
+	// ThreadPool down to parallelDepth (same tree as the serial build).
+	// MortonBuild is point mode only and ignores bParallel.
+	//
+	OctreeBuildType buildType = TopDownBuild;
+	bool bParallel = false;
+	int parallelDepth = 3;
+
+	// flat storage, read by all queries: node pool, shared point index
+	// buffer, packed copy of the mesh vertex positions.  These point either
+	// into the arrays filled by create() or straight into a mapped cache
+	// file (see load()).
+	//
+	const OctreeNode *nodes = NULL;
+	int numNodes = 0;
+	const int *pointIndices = NULL;
+	int numPointIndices = 0;
+	const Vector3 *verts = NULL;
+	int numVerts = 0;
+	const int *faces = NULL;        // 3 vertex indices per face (face mode)
+	int numFaces = 0;
+	const Box8 *childBlocks = NULL; // SoA child boxes of each interior node
+	int numChildBlocks = 0;
+
+	// meshHash() of the mesh behind the tree, when it came from
+	// createCached() or load() (0 otherwise); with the level count it
+	// names the cache file contents, e.g. for a LanderLog
+	//
+	uint64_t cacheHash = 0;
+	int cacheLevels = 0;
+
+	// debug; points (faces in face mode) the top-down build left out of
+	// every child box
+	//
+	int strayVerts= 0;
+
+protected:
+	bool intersectNode(const Box &, int nodeIndex, std::vector<Box> & boxListRtn, std::vector<int> * leafListRtn) const;
+
+private:
+	void finishBuild();
+	void bindStorage();
+
+	// storage owned by a build (empty when running from a cache file)
+	//
+	std::vector<OctreeNode> nodeStore;
+	std::vector<int> pointStore;
+	std::vector<Vector3> vertStore;
+	std::vector<int> faceStore;
+	std::vector<Box8> blockStore;
+	MappedFile cacheFile;
+
+	bool faceInBox(const Box & box, int face) const {
+		return box.overlap(verts[faces[face * 3]], verts[faces[face * 3 + 1]], verts[faces[face * 3 + 2]]);
+	}
+	int leafSize() const { return bUseFaces ? maxLeafFaces : 1; }
+	int splitNode(std::vector<OctreeNode> & pool, std::vector<int> & points, int nodeIndex);
+	int subdivide(std::vector<OctreeNode> & pool, std::vector<int> & points, int nodeIndex, int numLevels, int level);
+	int subdivideParallel(std::vector<OctreeNode> & pool, std::vector<int> & points, int numLevels, int level);
+	void createMorton(int numLevels);
+	void subdivideMorton(const std::vector<uint64_t> & codes, int nodeIndex, int numLevels, int level);
+	void closestHit(const Ray &, int nodeIndex, float tNear, OctreeHit & hit) const;
+	void leafHit(const Ray &, int nodeIndex, float tNear, OctreeHit & hit) const;
+	void closestHitPackets(const Ray * rays, int numRays, OctreeHit * hits, float tMax) const;
+	void closestHitPacket(const Ray * rays, const Ray8 & packet, int nodeIndex, int active,
+		const float tNear[8], OctreeHit * hits) const;
+};
+
+//  OctreeCollisionQuery - box query for an object that moves a little each
+//  frame (the lander).  It remembers the deepest node enclosing the last
+//  query box and starts the next query there, climbing toward the root
+//  only when the box has left that node.  Results go into buffers that are
+//  reused (cleared) on every query.
+//
+class OctreeCollisionQuery {
+public:
+	void setOctree(const OctreeCore *tree);
+	bool query(const Box &box);
+	bool sweep(const Box &box, const Vector3 &motion, float &t, Vector3 &normal);
+
+	std::vector<Box> boxes;     // leaf boxes hit by the last query
+	std::vector<int> leaves;    // leaf node indices hit by the last query
+	int startNode = 0;          // cached enclosing node
+
+private:
+	const OctreeCore *octree = NULL;
+};
+
+//  OctreeContact - the rotated box touching one terrain triangle
+//
+class OctreeContact {
+public:
+	Vector3 point;              // contact point (halfway into the overlap)
+	Vector3 normal;             // triangle normal, toward the box
+	float depth = 0;            // penetration along normal
+	int face = -1;              // face index in the octree mesh
+};
+
+//  OctreeContactQuery - narrow phase for a rotated box against a face mode
+//  octree: the leaves under the box's world bounds (searched from the
+//  cached enclosing node, as OctreeCollisionQuery does) give the candidate
+//  triangles, each tested once against the oriented box.  Buffers are
+//  reused between queries.
+//
+class OctreeContactQuery {
+public:
+	void setOctree(const OctreeCore *tree);
+	int query(const Obb &box);
+	bool sweep(const Obb &box, const Vector3 &motion, float &t, Vector3 &normal);
+
+	std::vector<OctreeContact> contacts;   // contacts of the last query
+	std::vector<Box> boxes;     // leaf boxes under the last query box (or sweep)
+	int startNode = 0;          // cached enclosing node
+
+private:
+	bool gather(const Box &bounds);
+
+	const OctreeCore *octree = NULL;
+	std::vector<int> leaves;
+	std::vector<int> candidates;
+};
@@ -25,12 +25,7 @@ void Particle::draw() {
 
 // write your own integrator here.. (hint: it's only 3 lines of code)
 //
-void Particle::integrate() {
-
-	
-	// interval for this step
-	//
-	float dt = 1.0 / ofGetFrameRate();
+void Particle::integrate(float dt) {
 
 	// update position based on velocity
 	//
@@ -17,7 +17,7 @@ public:
 	float   lifespan;
 	float   radius;
 	float   birthtime;
-	void    integrate();
+	void    integrate(float dt);
 	void    draw();
 	float   age();        // sec
 	ofColor color;
@@ -0,0 +1,100 @@
+#include "ParticleKernels.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//  scalar step for one particle (the remainder of the SIMD loops)
+//
+static inline void integrateOne(const ParticleSpan & p, int i, float dt, const float g[3]) {
+	p.posX[i] += p.velX[i] * dt;
+	p.posY[i] += p.velY[i] * dt;
+	p.posZ[i] += p.velZ[i] * dt;
+
+	float invMass = 1.0f / p.mass[i];
+	p.velX[i] = (p.velX[i] + (p.accX[i] + g[0] + p.forceX[i] * invMass) * dt) * p.damping[i];
+	p.velY[i] = (p.velY[i] + (p.accY[i] + g[1] + p.forceY[i] * invMass) * dt) * p.damping[i];
+	p.velZ[i] = (p.velZ[i] + (p.accZ[i] + g[2] + p.forceZ[i] * invMass) * dt) * p.damping[i];
+
+	p.forceX[i] = 0;
+	p.forceY[i] = 0;
+	p.forceZ[i] = 0;
+}
+
+#if defined(__AVX__)
+
+#define SIMD_WIDTH 8
+typedef __m256 simd;
+#define simdLoad _mm256_loadu_ps
+#define simdStore _mm256_storeu_ps
+#define simdSet1 _mm256_set1_ps
+#define simdZero _mm256_setzero_ps
+#define simdAdd _mm256_add_ps
+#define simdMul _mm256_mul_ps
+#define simdDiv _mm256_div_ps
+
+#elif defined(__SSE2__)
+
+#define SIMD_WIDTH 4
+typedef __m128 simd;
+#define simdLoad _mm_loadu_ps
+#define simdStore _mm_storeu_ps
+#define simdSet1 _mm_set1_ps
+#define simdZero _mm_setzero_ps
+#define simdAdd _mm_add_ps
+#define simdMul _mm_mul_ps
+#define simdDiv _mm_div_ps
+
+#endif
+
+void integrateParticles(const ParticleSpan & p, int begin, int end, float dt, const float accel[3]) {
+	static const float none[3] = { 0, 0, 0 };
+	const float *g = accel ? accel : none;
+	int i = begin;
+
+#ifdef SIMD_WIDTH
+	simd vdt = simdSet1(dt);
+	simd one = simdSet1(1.0f);
+	simd zero = simdZero();
+	for (; i + SIMD_WIDTH <= end; i += SIMD_WIDTH) {
+		simd invMass = simdDiv(one, simdLoad(p.mass + i));
+		simd damp = simdLoad(p.damping + i);
+
+		// one axis: position from the old velocity, then the new velocity
+		//
+		float *pos[3] = { p.posX, p.posY, p.posZ };
+		float *vel[3] = { p.velX, p.velY, p.velZ };
+		const float *acc[3] = { p.accX, p.accY, p.accZ };
+		float *force[3] = { p.forceX, p.forceY, p.forceZ };
+		for (int a = 0; a < 3; a++) {
+			simd v = simdLoad(vel[a] + i);
+			simdStore(pos[a] + i, simdAdd(simdLoad(pos[a] + i), simdMul(v, vdt)));
+			simd a0 = simdAdd(simdLoad(acc[a] + i), simdSet1(g[a]));
+			simd sum = simdAdd(a0, simdMul(simdLoad(force[a] + i), invMass));
+			simdStore(vel[a] + i, simdMul(simdAdd(v, simdMul(sum, vdt)), damp));
+			simdStore(force[a] + i, zero);
+		}
+	}
+#endif
+
+	for (; i < end; i++)
+		integrateOne(p, i, dt, g);
+}
+
+void packParticleInstances(const ParticleSpan & p, int begin, int end, float now, ParticleInstance *out) {
+	for (int i = begin; i < end; i++, out++) {
+		float age = (now - p.birthtime[i]) / 1000.0f;
+		float life = p.lifespan[i];
+		float red = life > 0 ? (255.0f - 245.0f * age / life) / 255.0f : 1.0f;
+		out->x = p.posX[i];
+		out->y = p.posY[i];
+		out->z = p.posZ[i];
+		out->radius = p.radius[i];
+		out->r = red < 0 ? 0 : (red > 1 ? 1 : red);
+		out->g = 0;
+		out->b = 0;
+		out->a = 1;
+	}
+}
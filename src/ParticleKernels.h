@@ -0,0 +1,50 @@
+#pragma once
+
+//  ParticleSpan - raw pointers to the per-attribute arrays of a particle
+//  store (see ParticleStore), so the batch kernels below need nothing but
+//  plain floats and can be benchmarked without openFrameworks.
+//
+class ParticleSpan {
+public:
+	float *posX = nullptr, *posY = nullptr, *posZ = nullptr;
+	float *velX = nullptr, *velY = nullptr, *velZ = nullptr;
+	const float *accX = nullptr, *accY = nullptr, *accZ = nullptr;
+	float *forceX = nullptr, *forceY = nullptr, *forceZ = nullptr;
+	const float *damping = nullptr;
+	const float *mass = nullptr;
+	const float *lifespan = nullptr;
+	const float *radius = nullptr;
+	const float *birthtime = nullptr;
+	int count = 0;
+};
+
+//  ParticleInstance - what the renderer needs per particle: one entry of
+//  the instance buffer drawn with a single instanced draw call (see
+//  ParticleRenderer).  8 floats, 32 bytes.
+//
+class ParticleInstance {
+public:
+	float x, y, z, radius;
+	float r, g, b, a;
+};
+
+//  integrateParticles - one integration step of dt seconds for particles
+//  [begin, end), the batch form of Particle::integrate():
+//
+//      position += velocity * dt
+//      velocity  = (velocity + (acceleration + accel + forces / mass) * dt) * damping
+//      forces    = 0
+//
+//  accel (optional) is an acceleration shared by all particles, such as
+//  gravity, applied here instead of being added to every particle's force.
+//  Uses AVX or SSE (8 or 4 particles per instruction) when compiled for
+//  them, with a scalar loop for the remainder.
+//
+void integrateParticles(const ParticleSpan & p, int begin, int end, float dt, const float accel[3] = nullptr);
+
+//  packParticleInstances - fill out[0 .. end-begin) with the instances of
+//  particles [begin, end) at time now (ms, the clock of birthtime): the
+//  position, the radius and the age ramp color Particle::draw() used
+//  (red from 255 at birth down to 10 at the end of the lifespan).
+//
+void packParticleInstances(const ParticleSpan & p, int begin, int end, float now, ParticleInstance *out);
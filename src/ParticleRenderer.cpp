@@ -0,0 +1,106 @@
+#include "ParticleRenderer.h"
+
+//  attribute slots for the two halves of a ParticleInstance (clear of the
+//  ones openFrameworks uses for position, color, normal and texcoord)
+//
+static const int instanceLocation = 4;
+static const int colorLocation = 5;
+
+static const char *vertexGL2 = R"(
+#version 120
+attribute vec4 instance;        // xyz = center, w = radius
+attribute vec4 instanceColor;
+varying vec4 color;
+void main() {
+	color = instanceColor;
+	gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xyz * instance.w + instance.xyz, 1.0);
+}
+)";
+
+static const char *fragmentGL2 = R"(
+#version 120
+varying vec4 color;
+void main() {
+	gl_FragColor = color;
+}
+)";
+
+static const char *vertexGL3 = R"(
+#version 150
+uniform mat4 modelViewProjectionMatrix;
+in vec4 position;
+in vec4 instance;               // xyz = center, w = radius
+in vec4 instanceColor;
+out vec4 color;
+void main() {
+	color = instanceColor;
+	gl_Position = modelViewProjectionMatrix * vec4(position.xyz * instance.w + instance.xyz, 1.0);
+}
+)";
+
+static const char *fragmentGL3 = R"(
+#version 150
+in vec4 color;
+out vec4 fragColor;
+void main() {
+	fragColor = color;
+}
+)";
+
+//  build the shared sphere and the shader; called on the first draw()
+//
+void ParticleRenderer::setup(int sphereResolution) {
+	ofMesh mesh = ofMesh::sphere(1, sphereResolution);
+	sphere.setMesh(mesh, GL_STATIC_DRAW);
+	numIndices = mesh.getNumIndices();
+
+	bool programmable = ofIsGLProgrammableRenderer();
+	shader.setupShaderFromSource(GL_VERTEX_SHADER, programmable ? vertexGL3 : vertexGL2);
+	shader.setupShaderFromSource(GL_FRAGMENT_SHADER, programmable ? fragmentGL3 : fragmentGL2);
+	if (programmable) shader.bindDefaults();
+	shader.bindAttribute(instanceLocation, "instance");
+	shader.bindAttribute(colorLocation, "instanceColor");
+	bInstanced = shader.linkProgram();
+	if (!bInstanced)
+		ofLogWarning("ParticleRenderer") << "instancing shader failed, drawing particles one by one";
+
+	bSetup = true;
+	reserve(1024);
+}
+
+//  grow the instance buffer to hold count instances (doubling, so a
+//  steady particle count stops reallocating)
+//
+void ParticleRenderer::reserve(int count) {
+	if (count <= bufferCount) return;
+	int n = bufferCount > 0 ? bufferCount : 1;
+	while (n < count) n *= 2;
+	buffer.allocate(n * sizeof(ParticleInstance), GL_STREAM_DRAW);
+	bufferCount = n;
+
+	int stride = sizeof(ParticleInstance);
+	sphere.setAttributeBuffer(instanceLocation, buffer, 4, stride, offsetof(ParticleInstance, x));
+	sphere.setAttributeBuffer(colorLocation, buffer, 4, stride, offsetof(ParticleInstance, r));
+	sphere.setAttributeDivisor(instanceLocation, 1);
+	sphere.setAttributeDivisor(colorLocation, 1);
+}
+
+void ParticleRenderer::draw(const ParticleInstance *instances, int count) {
+	if (count <= 0) return;
+	if (!bSetup) setup();
+
+	if (!bInstanced) {
+		for (int i = 0; i < count; i++) {
+			const ParticleInstance &p = instances[i];
+			ofSetColor(p.r * 255, p.g * 255, p.b * 255, p.a * 255);
+			ofDrawSphere(ofVec3f(p.x, p.y, p.z), p.radius);
+		}
+		return;
+	}
+
+	reserve(count);
+	buffer.updateData(0, count * sizeof(ParticleInstance), instances);
+	shader.begin();
+	sphere.drawElementsInstanced(GL_TRIANGLES, numIndices, count);
+	shader.end();
+}
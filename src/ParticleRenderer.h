@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ParticleKernels.h"
+
+//  ParticleRenderer - draws a whole particle system with one instanced
+//  draw call: the instances (packed on the CPU by packParticleInstances())
+//  are uploaded to a buffer object, and a shared low poly unit sphere is
+//  drawn once per instance, scaled, moved and colored in the vertex
+//  shader.  If the shader can't be built (no instancing on this GL) it
+//  falls back to drawing one sphere per particle.
+//
+class ParticleRenderer {
+public:
+	void setup(int sphereResolution = 8);
+	void draw(const ParticleInstance *instances, int count);
+
+	bool bInstanced = false;    // false = per particle fallback
+
+private:
+	void reserve(int count);
+
+	bool bSetup = false;
+	int numIndices = 0;
+	int bufferCount = 0;        // instances the buffer object has room for
+	ofVbo sphere;
+	ofBufferObject buffer;
+	ofShader shader;
+};
@@ -1,20 +1,288 @@
 #include "ParticleSystem.h"
 
-void ParticleSystem::add(const Particle &p) {
-	particles.push_back(p);
+//--------------------------------------------------------------
+//  ParticleStore
+//
+void ParticleStore::reserve(int n) {
+	posX.reserve(n);
+	posY.reserve(n);
+	posZ.reserve(n);
+	velX.reserve(n);
+	velY.reserve(n);
+	velZ.reserve(n);
+	accX.reserve(n);
+	accY.reserve(n);
+	accZ.reserve(n);
+	forceX.reserve(n);
+	forceY.reserve(n);
+	forceZ.reserve(n);
+	damping.reserve(n);
+	mass.reserve(n);
+	lifespan.reserve(n);
+	radius.reserve(n);
+	birthtime.reserve(n);
+	color.reserve(n);
+	older.reserve(n);
+	newer.reserve(n);
+}
+
+void ParticleStore::push(const Particle &p) {
+	if (posX.size() == posX.capacity()) allocations++;
+	posX.push_back(p.position.x);
+	posY.push_back(p.position.y);
+	posZ.push_back(p.position.z);
+	velX.push_back(p.velocity.x);
+	velY.push_back(p.velocity.y);
+	velZ.push_back(p.velocity.z);
+	accX.push_back(p.acceleration.x);
+	accY.push_back(p.acceleration.y);
+	accZ.push_back(p.acceleration.z);
+	forceX.push_back(p.forces.x);
+	forceY.push_back(p.forces.y);
+	forceZ.push_back(p.forces.z);
+	damping.push_back(p.damping);
+	mass.push_back(p.mass);
+	lifespan.push_back(p.lifespan);
+	radius.push_back(p.radius);
+	birthtime.push_back(p.birthtime);
+	color.push_back(p.color);
+	older.push_back(-1);
+	newer.push_back(-1);
+	linkNewest(size() - 1);
+}
+
+//  move the last particle into slot i and drop the last slot (O(1))
+//
+void ParticleStore::removeSwap(int i) {
+	int last = size() - 1;
+	unlink(i);
+	if (i != last) {
+		older[i] = older[last];
+		newer[i] = newer[last];
+		if (older[i] >= 0) newer[older[i]] = i;
+		else oldestSlot = i;
+		if (newer[i] >= 0) older[newer[i]] = i;
+		else newestSlot = i;
+		posX[i] = posX[last];
+		posY[i] = posY[last];
+		posZ[i] = posZ[last];
+		velX[i] = velX[last];
+		velY[i] = velY[last];
+		velZ[i] = velZ[last];
+		accX[i] = accX[last];
+		accY[i] = accY[last];
+		accZ[i] = accZ[last];
+		forceX[i] = forceX[last];
+		forceY[i] = forceY[last];
+		forceZ[i] = forceZ[last];
+		damping[i] = damping[last];
+		mass[i] = mass[last];
+		lifespan[i] = lifespan[last];
+		radius[i] = radius[last];
+		birthtime[i] = birthtime[last];
+		color[i] = color[last];
+	}
+	posX.pop_back();
+	posY.pop_back();
+	posZ.pop_back();
+	velX.pop_back();
+	velY.pop_back();
+	velZ.pop_back();
+	accX.pop_back();
+	accY.pop_back();
+	accZ.pop_back();
+	forceX.pop_back();
+	forceY.pop_back();
+	forceZ.pop_back();
+	damping.pop_back();
+	mass.pop_back();
+	lifespan.pop_back();
+	radius.pop_back();
+	birthtime.pop_back();
+	color.pop_back();
+	older.pop_back();
+	newer.pop_back();
+}
+
+//  make particle i the newest (its slot was given a new particle)
+//
+void ParticleStore::renew(int i) {
+	unlink(i);
+	linkNewest(i);
+}
+
+void ParticleStore::unlink(int i) {
+	if (older[i] >= 0) newer[older[i]] = newer[i];
+	else oldestSlot = newer[i];
+	if (newer[i] >= 0) older[newer[i]] = older[i];
+	else newestSlot = older[i];
+	older[i] = newer[i] = -1;
+}
+
+void ParticleStore::linkNewest(int i) {
+	older[i] = newestSlot;
+	newer[i] = -1;
+	if (newestSlot >= 0) newer[newestSlot] = i;
+	else oldestSlot = i;
+	newestSlot = i;
+}
+
+void ParticleStore::clear() {
+	posX.clear();
+	posY.clear();
+	posZ.clear();
+	velX.clear();
+	velY.clear();
+	velZ.clear();
+	accX.clear();
+	accY.clear();
+	accZ.clear();
+	forceX.clear();
+	forceY.clear();
+	forceZ.clear();
+	damping.clear();
+	mass.clear();
+	lifespan.clear();
+	radius.clear();
+	birthtime.clear();
+	color.clear();
+	older.clear();
+	newer.clear();
+	oldestSlot = newestSlot = -1;
+}
+
+//  copy of particle i as a Particle
+//
+Particle ParticleStore::get(int i) const {
+	Particle p;
+	get(i, p);
+	return p;
+}
+
+void ParticleStore::get(int i, Particle &p) const {
+	p.position.set(posX[i], posY[i], posZ[i]);
+	p.velocity.set(velX[i], velY[i], velZ[i]);
+	p.acceleration.set(accX[i], accY[i], accZ[i]);
+	p.forces.set(forceX[i], forceY[i], forceZ[i]);
+	p.damping = damping[i];
+	p.mass = mass[i];
+	p.lifespan = lifespan[i];
+	p.radius = radius[i];
+	p.birthtime = birthtime[i];
+	p.color = color[i];
+}
+
+void ParticleStore::set(int i, const Particle &p) {
+	posX[i] = p.position.x;
+	posY[i] = p.position.y;
+	posZ[i] = p.position.z;
+	velX[i] = p.velocity.x;
+	velY[i] = p.velocity.y;
+	velZ[i] = p.velocity.z;
+	accX[i] = p.acceleration.x;
+	accY[i] = p.acceleration.y;
+	accZ[i] = p.acceleration.z;
+	forceX[i] = p.forces.x;
+	forceY[i] = p.forces.y;
+	forceZ[i] = p.forces.z;
+	damping[i] = p.damping;
+	mass[i] = p.mass;
+	lifespan[i] = p.lifespan;
+	radius[i] = p.radius;
+	birthtime[i] = p.birthtime;
+	color[i] = p.color;
+}
+
+//  array pointers for the batch kernels
+//
+ParticleSpan ParticleStore::span() {
+	ParticleSpan p;
+	p.count = size();
+	if (p.count == 0) return p;
+	p.posX = &posX[0];
+	p.posY = &posY[0];
+	p.posZ = &posZ[0];
+	p.velX = &velX[0];
+	p.velY = &velY[0];
+	p.velZ = &velZ[0];
+	p.accX = &accX[0];
+	p.accY = &accY[0];
+	p.accZ = &accZ[0];
+	p.forceX = &forceX[0];
+	p.forceY = &forceY[0];
+	p.forceZ = &forceZ[0];
+	p.damping = &damping[0];
+	p.mass = &mass[0];
+	p.lifespan = &lifespan[0];
+	p.radius = &radius[0];
+	p.birthtime = &birthtime[0];
+	return p;
+}
+
+//--------------------------------------------------------------
+//  ParticleSystem
+//
+//  add a particle, subject to the overflow policy when at capacity.
+//  Returns false if the particle was dropped.
+//
+bool ParticleSystem::add(const Particle &p) {
+	nearTreeValid = false;
+	if (capacity > 0 && particles.size() >= capacity) {
+		switch (overflow) {
+		case DropNewest:
+			dropped++;
+			return false;
+		case DropOldest:
+		{
+			int oldest = particles.oldest();
+			particles.set(oldest, p);
+			particles.renew(oldest);
+			dropped++;
+			return true;
+		}
+		case GrowPool:
+			break;
+		}
+	}
+	particles.push(p);
+	return true;
+}
+
+void ParticleSystem::setCapacity(int cap, ParticleOverflow policy) {
+	capacity = cap;
+	overflow = policy;
+	particles.reserve(cap);
+	instances.reserve(cap);
 }
 
 void ParticleSystem::addForce(ParticleForce *f) {
 	forces.push_back(f);
 }
 
+//  remove particle i (the last particle takes its place)
+//
 void ParticleSystem::remove(int i) {
-	particles.erase(particles.begin() + i);
+	removeSlot(i);
+}
+
+//  removeSwap() that also keeps the removeNear() tree's slot map current
+//
+void ParticleSystem::removeSlot(int i) {
+	if (nearTreeValid) {
+		int last = particles.size() - 1;
+		nearSlot[nearPoint[i]] = -1;
+		if (i != last) {
+			nearPoint[i] = nearPoint[last];
+			nearSlot[nearPoint[i]] = i;
+		}
+		nearPoint.pop_back();
+	}
+	particles.removeSwap(i);
 }
 
 void ParticleSystem::setLifespan(float l) {
 	for (int i = 0; i < particles.size(); i++) {
-		particles[i].lifespan = l;
+		particles.lifespan[i] = l;
 	}
 }
 
@@ -24,31 +292,53 @@ void ParticleSystem::reset() {
 	}
 }
 
+//  step by the real time since the last frame, in fixed steps
+//
 void ParticleSystem::update() {
+	int steps = clock.advance(ofGetLastFrameTime());
+	for (int i = 0; i < steps; i++)
+		update(clock.step);
+}
+
+//  step all particles by dt seconds
+//
+void ParticleSystem::update(float dt) {
+	nearTreeValid = false;
+
 	// check if empty and just return
 	if (particles.size() == 0) return;
 
-	vector<Particle>::iterator p = particles.begin();
-	vector<Particle>::iterator tmp;
-
-	// check which particles have exceed their lifespan and delete
-	// from list.  When deleting multiple objects from a vector while
-	// traversing at the same time, we need to use an iterator.
+	// check which particles have exceed their lifespan and delete them.
+	// A removed particle is replaced by the last one, so stay on the same
+	// slot and check the particle that moved in.
 	//
-	while (p != particles.end()) {
-		if (p->lifespan != -1 && p->age() > p->lifespan) {
-			tmp = particles.erase(p);
-			p = tmp;
-		}
-		else p++;
+	float now = ofGetElapsedTimeMillis();
+	int i = 0;
+	while (i < particles.size()) {
+		float life = particles.lifespan[i];
+		if (life != -1 && (now - particles.birthtime[i]) / 1000.0 > life)
+			particles.removeSwap(i);
+		else i++;
 	}
+	int n = particles.size();
 
-	// update forces on all particles first 
+	// update forces on all particles first.  Uniform accelerations
+	// (gravity) are summed and folded into the integration step, forces
+	// that can't run on worker threads are applied here over the whole
+	// range, and the rest are applied per chunk below.
 	//
-	for (int i = 0; i < particles.size(); i++) {
-		for (int k = 0; k < forces.size(); k++) {
-			if (!forces[k]->applied)
-				forces[k]->updateForce( &particles[i] );
+	ofVec3f uniform = ofVec3f(0, 0, 0);
+	chunkForces.clear();
+	for (int k = 0; k < forces.size(); k++) {
+		if (forces[k]->applied) continue;
+		ofVec3f accel;
+		if (forces[k]->uniformAcceleration(accel))
+			uniform += accel;
+		else if (forces[k]->parallelSafe())
+			chunkForces.push_back(forces[k]);
+		else {
+			Rng rng(streamSeed(-1 - k));
+			forces[k]->updateForces(particles, 0, n, rng);
 		}
 	}
 
@@ -60,26 +350,102 @@ void ParticleSystem::update() {
 			forces[i]->applied = true;
 	}
 
-	// integrate all the particles in the store
+	// chunk forces, then integrate (batch Particle::integrate)
 	//
-	for (int i = 0; i < particles.size(); i++)
-		particles[i].integrate();
+	float accel[3] = { uniform.x, uniform.y, uniform.z };
+	ParticleSpan span = particles.span();
+	int numChunks = (n + chunkSize - 1) / chunkSize;
+	auto runChunk = [this, &span, &accel, n, dt](int c) {
+		int begin = c * chunkSize;
+		int end = std::min(begin + chunkSize, n);
+		Rng rng(streamSeed(c));
+		for (int k = 0; k < chunkForces.size(); k++)
+			chunkForces[k]->updateForces(particles, begin, end, rng);
+		integrateParticles(span, begin, end, dt, accel);
+	};
+	ThreadPool & threads = ThreadPool::shared();
+	if (bParallel && numChunks > 1 && threads.size() > 0) {
+		TaskGroup group;
+		for (int c = 0; c < numChunks; c++)
+			threads.submit(group, [&runChunk, c] { runChunk(c); });
+		threads.wait(group);
+	}
+	else {
+		for (int c = 0; c < numChunks; c++)
+			runChunk(c);
+	}
+	frame++;
+}
 
+//  seed of random stream "stream" for the current frame
+//
+uint64_t ParticleSystem::streamSeed(int stream) const {
+	Rng mix(seed + frame * 0x9e3779b97f4a7c15ULL + (uint64_t)(int64_t)stream * 0xbf58476d1ce4e5b9ULL);
+	return mix.next();
 }
 
-// remove all particlies within "dist" of point (not implemented as yet)
+//  remove all particles within "dist" of point; returns how many.  The
+//  position octree is rebuilt only when the particles have moved or been
+//  added since the last call, so a burst of removals in one frame costs
+//  one build plus a radius query each.
 //
-int ParticleSystem::removeNear(const ofVec3f & point, float dist) { return 0; }
+int ParticleSystem::removeNear(const ofVec3f & point, float dist) {
+	int n = particles.size();
+	if (n == 0) return 0;
+	if (!nearTreeValid) {
+		nearPositions.resize(n);
+		nearSlot.resize(n);
+		nearPoint.resize(n);
+		for (int i = 0; i < n; i++) {
+			nearPositions[i] = Vector3(particles.posX[i], particles.posY[i], particles.posZ[i]);
+			nearSlot[i] = nearPoint[i] = i;
+		}
+		nearTree.buildType = MortonBuild;
+		nearTree.create(nearPositions, vector<int>(), nearLevels);
+		nearTreeValid = true;
+	}
+	nearTree.withinRadius(Vector3(point.x, point.y, point.z), dist, nearHits);
+
+	// remove from the highest slot down, so the particle swapped into a
+	// hole is never one still waiting to be removed
+	//
+	nearRemoved.clear();
+	for (int i = 0; i < nearHits.size(); i++) {
+		int slot = nearSlot[nearHits[i].index];
+		if (slot >= 0) nearRemoved.push_back(slot);
+	}
+	sort(nearRemoved.begin(), nearRemoved.end());
+	for (int i = nearRemoved.size() - 1; i >= 0; i--)
+		removeSlot(nearRemoved[i]);
+	return nearRemoved.size();
+}
 
 //  draw the particle cloud
 //
 void ParticleSystem::draw() {
-	for (int i = 0; i < particles.size(); i++) {
-		particles[i].draw();
-	}
+	int n = particles.size();
+	instances.resize(n);
+	if (n == 0) return;
+	packParticleInstances(particles.span(), 0, n, ofGetElapsedTimeMillis(), &instances[0]);
+	renderer.draw(&instances[0], n);
 }
 
 
+//  batch form of updateForce(): apply to particles [begin, end) one at a
+//  time through a Particle copy (subclasses override this for speed).
+//  Only the force is written back; a force adds to particle->forces.
+//
+void ParticleForce::updateForces(ParticleStore & particles, int begin, int end, Rng & rng) {
+	Particle p;
+	for (int i = begin; i < end; i++) {
+		particles.get(i, p);
+		updateForce(&p);
+		particles.forceX[i] = p.forces.x;
+		particles.forceY[i] = p.forces.y;
+		particles.forceZ[i] = p.forces.z;
+	}
+}
+
 // Gravity Force Field 
 //
 GravityForce::GravityForce(const ofVec3f &g) {
@@ -93,6 +459,13 @@ void GravityForce::updateForce(Particle * particle) {
 	particle->forces += gravity * particle->mass;
 }
 
+//  f = mg is the same acceleration g for every particle
+//
+bool GravityForce::uniformAcceleration(ofVec3f & accel) const {
+	accel = gravity;
+	return true;
+}
+
 // Turbulence Force Field 
 //
 TurbulenceForce::TurbulenceForce(const ofVec3f &min, const ofVec3f &max) {
@@ -110,6 +483,14 @@ void TurbulenceForce::updateForce(Particle * particle) {
 	particle->forces.z += ofRandom(tmin.z, tmax.z);
 }
 
+void TurbulenceForce::updateForces(ParticleStore & particles, int begin, int end, Rng & rng) {
+	for (int i = begin; i < end; i++) {
+		particles.forceX[i] += rng.range(tmin.x, tmax.x);
+		particles.forceY[i] += rng.range(tmin.y, tmax.y);
+		particles.forceZ[i] += rng.range(tmin.z, tmax.z);
+	}
+}
+
 // Impulse Radial Force - this is a "one shot" force that
 // eminates radially outward in random directions.
 //
@@ -127,6 +508,15 @@ void ImpulseRadialForce::updateForce(Particle * particle) {
 	particle->forces += dir.getNormalized() * magnitude;
 }
 
+void ImpulseRadialForce::updateForces(ParticleStore & particles, int begin, int end, Rng & rng) {
+	for (int i = begin; i < end; i++) {
+		ofVec3f dir = ofVec3f(rng.range(-1, 1), rng.range(-height/4, height/4), rng.range(-1, 1)).getNormalized() * magnitude;
+		particles.forceX[i] += dir.x;
+		particles.forceY[i] += dir.y;
+		particles.forceZ[i] += dir.z;
+	}
+}
+
 //set height
 void ImpulseRadialForce::setHeight(float h) {
      height = h;       //set height 
@@ -2,30 +2,159 @@
 
 #include "ofMain.h"
 #include "Particle.h"
+#include "ParticleKernels.h"
+#include "ParticleRenderer.h"
+#include "ThreadPool.h"
+#include "Rng.h"
+#include "SimClock.h"
+#include "OctreeCore.h"
 
 
+//  ParticleStore - particles kept as a structure of arrays: one contiguous
+//  array per attribute, so the force and integrate passes stream through
+//  plain floats.  Particle i is entry i of every array.  Removal moves the
+//  last particle into the hole (order is not preserved).
+//
+//  The slots are also linked in age order, from the particle pushed (or
+//  renewed) longest ago to the newest, so the oldest is found without a
+//  scan.  push(), renew(), removeSwap() and clear() keep the links.
+//
+class ParticleStore {
+public:
+	int size() const { return posX.size(); }
+	void reserve(int n);
+	void push(const Particle &);
+	void removeSwap(int i);
+	void renew(int i);
+	int oldest() const { return oldestSlot; }
+	void clear();
+	Particle get(int i) const;
+	void get(int i, Particle &) const;
+	void set(int i, const Particle &);
+	ParticleSpan span();
+
+	vector<float> posX, posY, posZ;
+	vector<float> velX, velY, velZ;
+	vector<float> accX, accY, accZ;
+	vector<float> forceX, forceY, forceZ;
+	vector<float> damping;
+	vector<float> mass;
+	vector<float> lifespan;
+	vector<float> radius;
+	vector<float> birthtime;
+	vector<ofColor> color;
+
+	int allocations = 0;        // times push() had to grow the arrays
+
+private:
+	void unlink(int i);
+	void linkNewest(int i);
+
+	vector<int> older, newer;   // neighbor slots in age order (-1 = none)
+	int oldestSlot = -1, newestSlot = -1;
+};
+
 //  Pure Virtual Function Class - must be subclassed to create new forces.
 //
+//  updateForces() applies the force to a whole range of particles with one
+//  call; the default just calls updateForce() on a copy of each particle,
+//  so a subclass only has to override it to get a batch fast path.  A
+//  force that is the same acceleration for every particle (gravity) can
+//  instead report it from uniformAcceleration() and is then folded into
+//  the integration step without touching the force arrays at all.
+//
+//  Random forces draw from the rng passed to updateForces() (one stream
+//  per chunk of particles) so a run can be reproduced.  Forces that say
+//  they are parallelSafe() are applied chunk by chunk on worker threads;
+//  the others run on the calling thread over all particles first.
+//
 class ParticleForce {
 protected:
 public:
 	bool applyOnce = false;
 	bool applied = false;
+	virtual ~ParticleForce() { }
 	virtual void updateForce(Particle *) = 0;
+	virtual void updateForces(ParticleStore & particles, int begin, int end, Rng & rng);
+	virtual bool uniformAcceleration(ofVec3f & accel) const { return false; }
+	virtual bool parallelSafe() const { return false; }
 };
 
+//  what add() does when the system already holds capacity particles
+//
+typedef enum { DropOldest, DropNewest, GrowPool } ParticleOverflow;
+
 class ParticleSystem {
 public:
-	void add(const Particle &);
+	bool add(const Particle &);
+	void setCapacity(int capacity, ParticleOverflow policy = DropOldest);
 	void addForce(ParticleForce *);
 	void remove(int);
 	void update();
+	void update(float dt);
 	void setLifespan(float);
 	void reset();
 	int removeNear(const ofVec3f & point, float dist);
 	void draw();
-	vector<Particle> particles;
+	ParticleStore particles;
 	vector<ParticleForce *> forces;
+
+	// fixed capacity pool: setCapacity() preallocates the arrays so adding
+	// and removing particles never touches the heap (particles.allocations
+	// stays put).  On overflow the oldest particle is replaced, the new
+	// one is dropped, or the pool grows.  capacity 0 = no limit.  Above
+	// chunkSize a parallel update submits one ThreadPool task per chunk;
+	// those reuse the pool's task slots, so after the first frames the
+	// update allocates nothing either.
+	//
+	int capacity = 0;
+	ParticleOverflow overflow = GrowPool;
+	int dropped = 0;            // particles lost to overflow
+
+	// the update runs in chunks of chunkSize particles, each with its own
+	// random stream seeded from seed, the frame number and the chunk, so
+	// the result does not depend on how many threads ran it.  With
+	// bParallel the chunks are spread over the shared ThreadPool.
+	//
+	bool bParallel = true;
+	int chunkSize = 4096;
+	uint64_t seed = 1;
+	uint64_t frame = 0;
+
+	// update() steps by the real frame time in fixed clock.step steps
+	// (update(dt) steps exactly dt)
+	//
+	SimClock clock;
+
+	// removeNear() asks a point octree of the particle positions, built on
+	// the first call after the particles last moved or were added, so
+	// further calls in the same frame only walk the tree.  nearLevels is
+	// its depth.
+	//
+	int nearLevels = 10;
+
+	// draw() packs the live particles into instances (the CPU half, see
+	// packParticleInstances()) and hands them to the renderer as one
+	// instanced draw
+	//
+	vector<ParticleInstance> instances;
+	ParticleRenderer renderer;
+
+private:
+	uint64_t streamSeed(int stream) const;
+	void removeSlot(int i);
+	vector<ParticleForce *> chunkForces;
+
+	// position octree for removeNear(); removals keep it valid by tracking
+	// which slot each of its points moved to (-1 once removed)
+	//
+	OctreeCore nearTree;
+	bool nearTreeValid = false;
+	vector<Vector3> nearPositions;
+	vector<int> nearSlot;           // tree point -> particle slot
+	vector<int> nearPoint;          // particle slot -> tree point
+	vector<OctreeNeighbor> nearHits;
+	vector<int> nearRemoved;
 };
 
 
@@ -37,6 +166,7 @@ class GravityForce: public ParticleForce {
 public:
 	GravityForce(const ofVec3f & gravity);
 	void updateForce(Particle *);
+	bool uniformAcceleration(ofVec3f & accel) const;
 };
 
 class TurbulenceForce : public ParticleForce {
@@ -44,6 +174,8 @@ class TurbulenceForce : public ParticleForce {
 public:
 	TurbulenceForce(const ofVec3f & min, const ofVec3f &max);
 	void updateForce(Particle *);
+	void updateForces(ParticleStore & particles, int begin, int end, Rng & rng);
+	bool parallelSafe() const { return true; }
 };
 
 class ImpulseRadialForce : public ParticleForce {
@@ -52,6 +184,8 @@ class ImpulseRadialForce : public ParticleForce {
 public:
 	ImpulseRadialForce(float magnitude); 
 	void updateForce(Particle *);
+	void updateForces(ParticleStore & particles, int begin, int end, Rng & rng);
+	bool parallelSafe() const { return true; }
     void setHeight(float);
     float getHeight();
 };
@@ -59,8 +59,10 @@ void ofApp::setup(){
 	gui.add(numLevels.setup("Number of Octree Levels", 1, 1, 10));
 	bHide = false;
 
-	//  Create Octree for testing.
+	//  Create Octree for testing.  Z-order build: it puts every vertex in
+	//  a leaf, so the point queries of doPointSelection() see them all.
 	//
+	octree.buildType = MortonBuild;
 	float t1 = ofGetElapsedTimeMillis();
 	octree.create(mars.getMesh(0), 20);
 	float t2 = ofGetElapsedTimeMillis();
@@ -341,50 +343,44 @@ void ofApp::mouseReleased(int x, int y, int button) {
 //  vertice points projected onto screenspace.
 //  if a point is selected, return true, else return false;
 //
+//  The vertices within selectionRange pixels of the mouse lie in a thin
+//  cone around the mouse ray from the eye.  So rather than project every
+//  mesh vertex, we ask the octree for the points in that cone (at any
+//  depth, whether or not the ray itself meets the terrain), and only
+//  project those.
+//
 bool ofApp::doPointSelection() {
 
-	ofMesh mesh = mars.getMesh(0);
-	int n = mesh.getNumVertices();
-	float nearestDistance = 0;
-	int nearestIndex = 0;
-
 	bPointSelected = false;
 
 	ofVec2f mouse(mouseX, mouseY);
-	vector<ofVec3f> selection;
+	ofVec3f eye = cam.getPosition();
+	ofVec3f rayDir = cam.screenToWorld(ofVec3f(mouseX, mouseY)) - eye;
+	rayDir.normalize();
+	Ray ray = Ray(Vector3(eye.x, eye.y, eye.z), Vector3(rayDir.x, rayDir.y, rayDir.z));
 
-	// We check through the mesh vertices to see which ones
-	// are "close" to the mouse point in screen space.  If we find 
-	// points that are close, we store them in a vector (dynamic array)
+	// selectionRange pixels as a slope: world size at depth 1 on the view
+	// axis.  A ray at angle a to the axis reaches depth 1 at 1 / cos a and
+	// sees the pixel tilted, so across the ray a pixel is pixel * cos a
+	// wide for its length; a little wider so the cone holds every point
+	// the screen test below takes, at any field of view
 	//
-	for (int i = 0; i < n; i++) {
-		ofVec3f vert = mesh.getVertex(i);
-		ofVec3f posScreen = cam.worldToScreen(vert);
-		float distance = posScreen.distance(mouse);
-		if (distance < selectionRange) {
-			selection.push_back(vert);
-			bPointSelected = true;
-		}
-	}
-
-	//  if we found selected points, we need to determine which
-	//  one is closest to the eye (camera). That one is our selected target.
+	float pixel = 2 * tan(ofDegToRad(cam.getFov() / 2)) / ofGetViewportHeight();
+	float cosAxis = -rayDir.dot(cam.getZAxis());
+	vector<OctreeNeighbor> candidates;
+	octree.withinCone(ray, 1.5 * selectionRange * pixel * cosAxis, candidates);
+
+	// the candidates come closest to the eye (camera) first, so the first
+	// one that is "close" to the mouse point in screen space is our
+	// selected target
 	//
-	if (bPointSelected) {
-		float distance = 0;
-		for (int i = 0; i < selection.size(); i++) {
-			ofVec3f point =  cam.worldToCamera(selection[i]);
-
-			// In camera space, the camera is at (0,0,0), so distance from 
-			// the camera is simply the length of the point vector
-			//
-			float curDist = point.length(); 
-
-			if (i == 0 || curDist < distance) {
-				distance = curDist;
-				selectedPoint = selection[i];
-			}
-		}
+	for (int i = 0; i < candidates.size(); i++) {
+		ofVec3f vert(candidates[i].point.x(), candidates[i].point.y(), candidates[i].point.z());
+		ofVec3f posScreen = cam.worldToScreen(vert);
+		if (posScreen.distance(mouse) >= selectionRange) continue;
+		selectedPoint = vert;
+		bPointSelected = true;
+		break;
 	}
 	return bPointSelected;
 }
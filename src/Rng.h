@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+//  Rng - small seeded random number generator (splitmix64).  Unlike
+//  ofRandom() each instance is its own stream, so a simulation seeded the
+//  same way always draws the same numbers, on any thread.
+//
+class Rng {
+public:
+	Rng(uint64_t seed = 0) : state(seed) { }
+
+	void seed(uint64_t s) { state = s; }
+
+	uint64_t next() {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	// uniform in [0, 1)
+	//
+	float uniform() { return (next() >> 40) * (1.0f / 16777216.0f); }
+
+	// uniform in [lo, hi)
+	//
+	float range(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+
+private:
+	uint64_t state;
+};
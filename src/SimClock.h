@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+//  SimClock - fixed timestep clock for the physics.  Each frame the real
+//  time that went by is added to an accumulator and the simulation is
+//  advanced in whole steps of step seconds, so it behaves the same at any
+//  render rate.  What is left over (less than one step) carries into the
+//  next frame; alpha() is that fraction, for drawing in between the last
+//  two simulated states.
+//
+//  A slow frame runs at most maxSubsteps steps; the time beyond that is
+//  dropped (and counted in skipped) so the simulation slows down instead
+//  of spiraling.  A first frame with no usable time (frame rate 0, a
+//  negative or NaN delta) just runs no steps.
+//
+class SimClock {
+public:
+	SimClock(float step = 1.0 / 60, int maxSubsteps = 8) : step(step), maxSubsteps(maxSubsteps) { }
+
+	// add elapsed seconds of real time; returns the number of steps to run
+	//
+	int advance(double elapsed) {
+		if (!(elapsed > 0)) return 0;
+		accumulator += elapsed;
+		int n = (int)((accumulator + slop) / step);
+		accumulator -= n * (double)step;
+		if (accumulator < 0) accumulator = 0;
+		if (n > maxSubsteps) {
+			skipped += n - maxSubsteps;
+			n = maxSubsteps;
+		}
+		steps += n;
+		return n;
+	}
+
+	// fraction of a step not yet simulated, in [0, 1)
+	//
+	float alpha() const { return accumulator / step; }
+
+	void reset() {
+		accumulator = 0;
+		steps = 0;
+		skipped = 0;
+	}
+
+	float step;                 // seconds per simulation step
+	int maxSubsteps;            // most steps run for one frame
+	double accumulator = 0;     // seconds not yet simulated
+	uint64_t steps = 0;         // steps run since reset
+	uint64_t skipped = 0;       // steps dropped by the substep cap
+
+private:
+	// a frame of exactly one step (1/60 s against a float step) must not
+	// round down to zero steps
+	//
+	static constexpr double slop = 1e-6;
+};
@@ -0,0 +1,509 @@
+#include "TerrainSdf.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+using namespace std;
+
+const int TerrainSdf::brickCells;
+const int TerrainSdf::brickSide;
+const int TerrainSdf::brickSamples;
+const int32_t TerrainSdf::outsideBrick;
+const int32_t TerrainSdf::insideBrick;
+
+static const int maxCells = 4096;           // per axis
+static const int bricksPerTask = 32;
+
+//  closest point on triangle abc to p (Ericson, "Real-Time Collision
+//  Detection" 5.1.5); feature is where it lies: 0 the face, 1 .. 3
+//  vertex a, b, c, 4 .. 6 edge ab, bc, ca
+//
+static Vector3 closestOnTriangle(const Vector3 &p, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+	int &feature) {
+	Vector3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = ab * ap, d2 = ac * ap;
+	if (d1 <= 0 && d2 <= 0) {
+		feature = 1;
+		return a;
+	}
+	Vector3 bp = p - b;
+	float d3 = ab * bp, d4 = ac * bp;
+	if (d3 >= 0 && d4 <= d3) {
+		feature = 2;
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		feature = 4;
+		return a + ab * (d1 / (d1 - d3));
+	}
+	Vector3 cp = p - c;
+	float d5 = ab * cp, d6 = ac * cp;
+	if (d6 >= 0 && d5 <= d6) {
+		feature = 3;
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		feature = 6;
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		feature = 5;
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	float denom = 1 / (va + vb + vc);
+	feature = 0;
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+//  angle weighted pseudonormals (Baerentzen and Aanaes): the sign of
+//  (p - q) . n, with n the normal of the face, edge or vertex holding the
+//  closest point q, is the side of the surface p is on, also at edges and
+//  vertices.  Vertices are welded by position first, so split vertices
+//  (uv or normal seams) still share their edges.
+//
+class Pseudonormals {
+public:
+	Pseudonormals(const Vector3 *verts, int numVerts, const int *faces, int numFaces) {
+		vector<int> order(numVerts);
+		for (int i = 0; i < numVerts; i++) order[i] = i;
+		sort(order.begin(), order.end(), [verts](int a, int b) {
+			if (verts[a].x() != verts[b].x()) return verts[a].x() < verts[b].x();
+			if (verts[a].y() != verts[b].y()) return verts[a].y() < verts[b].y();
+			return verts[a].z() < verts[b].z();
+		});
+		weld.resize(numVerts);
+		for (int i = 0; i < numVerts; i++)
+			weld[order[i]] = (i > 0 && verts[order[i]] == verts[order[i - 1]]) ? weld[order[i - 1]] : order[i];
+
+		face.resize(numFaces);
+		vertex.assign(numVerts, Vector3(0, 0, 0));
+		unordered_map<uint64_t, Vector3> edges;
+		for (int f = 0; f < numFaces; f++) {
+			const int *t = faces + 3 * f;
+			Vector3 n = (verts[t[1]] - verts[t[0]]) ^ (verts[t[2]] - verts[t[0]]);
+			if (n.length() > 0) n.normalize();
+			face[f] = n;
+			for (int k = 0; k < 3; k++) {
+				Vector3 e1 = verts[t[(k + 1) % 3]] - verts[t[k]];
+				Vector3 e2 = verts[t[(k + 2) % 3]] - verts[t[k]];
+				float l = e1.length() * e2.length();
+				float angle = l > 0 ? acosf(fmaxf(-1.0f, fminf(1.0f, (e1 * e2) / l))) : 0;
+				vertex[weld[t[k]]] = vertex[weld[t[k]]] + n * angle;
+				uint64_t key = edgeKey(t[k], t[(k + 1) % 3]);
+				unordered_map<uint64_t, Vector3>::iterator e = edges.find(key);
+				if (e == edges.end()) edges.insert(make_pair(key, n));
+				else e->second = e->second + n;
+			}
+		}
+		edge.resize(numFaces * 3);
+		for (int f = 0; f < numFaces; f++)
+			for (int k = 0; k < 3; k++)
+				edge[3 * f + k] = edges[edgeKey(faces[3 * f + k], faces[3 * f + (k + 1) % 3])];
+	}
+
+	// normal for the feature (closestOnTriangle()) of face f
+	//
+	Vector3 normal(const int *faces, int f, int feature) const {
+		if (feature == 0) return face[f];
+		if (feature <= 3) return vertex[weld[faces[3 * f + feature - 1]]];
+		return edge[3 * f + feature - 4];
+	}
+
+private:
+	uint64_t edgeKey(int a, int b) const {
+		uint32_t u = weld[a], v = weld[b];
+		if (u > v) swap(u, v);
+		return ((uint64_t)u << 32) | v;
+	}
+
+	vector<int> weld;
+	vector<Vector3> face, vertex, edge;
+};
+
+//--------------------------------------------------------------
+//  build
+//
+void TerrainSdf::create(const OctreeCore *surface, float cellSize, float bandWidth) {
+	brickStore.clear();
+	sampleStore.clear();
+	cacheFile.close();
+	bricks = NULL;
+	samples = NULL;
+	numBricks = 0;
+	bricksX = bricksY = bricksZ = 0;
+	cellSetting = cellSize;
+	bandSetting = bandWidth;
+	if (surface == NULL || !surface->bUseFaces || surface->numFaces == 0) return;
+	const Vector3 *v = surface->verts;
+	const int *f = surface->faces;
+	int numFaces = surface->numFaces;
+
+	// mesh bounds, mean edge length and which way the mesh faces (the
+	// side "above" a terrain with inward winding is still positive)
+	//
+	Box meshBounds = OctreeCore::bounds(v, surface->numVerts);
+	double area = 0, upArea = 0, downArea = 0;
+	for (int k = 0; k < numFaces; k++) {
+		Vector3 n = (v[f[3 * k + 1]] - v[f[3 * k]]) ^ (v[f[3 * k + 2]] - v[f[3 * k]]);
+		area += n.length() / 2;
+		if (n.y() > 0) upArea += n.y();
+		else downArea -= n.y();
+	}
+	float facing = upArea >= downArea ? 1 : -1;
+	cell = cellSize > 0 ? cellSize : sqrt(2 * area / numFaces);
+	Vector3 size = meshBounds.max() - meshBounds.min();
+	float extent = fmaxf(size.x(), fmaxf(size.y(), size.z()));
+	if (!(cell > 0) || extent / cell > maxCells)
+		cell = extent > 0 ? extent / maxCells : 1;
+	band = bandWidth > 0 ? bandWidth : 4 * cell;
+
+	Vector3 pad(band, band, band);
+	origin = meshBounds.min() - pad;
+	size = size + pad * 2;
+	float brickSize = cell * brickCells;
+	bricksX = max(1, (int)ceil(size.x() / brickSize));
+	bricksY = max(1, (int)ceil(size.y() / brickSize));
+	bricksZ = max(1, (int)ceil(size.z() / brickSize));
+	int numTable = bricksX * bricksY * bricksZ;
+
+	// triangles near each brick (within band of it)
+	//
+	vector<vector<int>> near(numTable);
+	for (int k = 0; k < numFaces; k++) {
+		const Vector3 &a = v[f[3 * k]], &b = v[f[3 * k + 1]], &c = v[f[3 * k + 2]];
+		int lo[3], hi[3], num[3] = { bricksX, bricksY, bricksZ };
+		for (int i = 0; i < 3; i++) {
+			float t0 = fminf(a[i], fminf(b[i], c[i])) - band - origin[i];
+			float t1 = fmaxf(a[i], fmaxf(b[i], c[i])) + band - origin[i];
+			lo[i] = max(0, (int)floor(t0 / brickSize));
+			hi[i] = min(num[i] - 1, (int)floor(t1 / brickSize));
+		}
+		for (int z = lo[2]; z <= hi[2]; z++)
+			for (int y = lo[1]; y <= hi[1]; y++)
+				for (int x = lo[0]; x <= hi[0]; x++)
+					near[(z * bricksY + y) * bricksX + x].push_back(k);
+	}
+	vector<int> active;
+	for (int i = 0; i < numTable; i++)
+		if (!near[i].empty()) active.push_back(i);
+
+	// exact distance at every sample within band of a triangle; each
+	// triangle only visits the samples inside its bounds grown by band
+	//
+	Pseudonormals normals(v, surface->numVerts, f, numFaces);
+	vector<vector<float>> values(numTable);
+	auto buildBrick = [&](int index) {
+		int bx = index % bricksX, by = (index / bricksX) % bricksY, bz = index / (bricksX * bricksY);
+		int base[3] = { bx * brickCells, by * brickCells, bz * brickCells };
+		vector<float> best(brickSamples, band * band);
+		vector<float> &d = values[index];
+		d.assign(brickSamples, NAN);
+		for (size_t n = 0; n < near[index].size(); n++) {
+			int k = near[index][n];
+			const Vector3 &a = v[f[3 * k]], &b = v[f[3 * k + 1]], &c = v[f[3 * k + 2]];
+			const Vector3 &plane = normals.normal(f, k, 0);
+			int lo[3], hi[3];
+			for (int i = 0; i < 3; i++) {
+				float t0 = (fminf(a[i], fminf(b[i], c[i])) - band - origin[i]) / cell - base[i];
+				float t1 = (fmaxf(a[i], fmaxf(b[i], c[i])) + band - origin[i]) / cell - base[i];
+				lo[i] = max(0, (int)ceil(t0));
+				hi[i] = min(brickCells, (int)floor(t1));
+			}
+			for (int z = lo[2]; z <= hi[2]; z++) {
+				for (int y = lo[1]; y <= hi[1]; y++) {
+					for (int x = lo[0]; x <= hi[0]; x++) {
+						Vector3 p = origin + Vector3(base[0] + x, base[1] + y, base[2] + z) * cell;
+						int s = (z * brickSide + y) * brickSide + x;
+						float h = (p - a) * plane;          // plane distance: a lower bound
+						if (h * h >= best[s]) continue;
+						int feature;
+						Vector3 q = closestOnTriangle(p, a, b, c, feature);
+						Vector3 pq = p - q;
+						float dist2 = pq * pq;
+						if (dist2 >= best[s]) continue;
+						best[s] = dist2;
+						float dist = sqrtf(dist2);
+						d[s] = (pq * normals.normal(f, k, feature)) * facing < 0 ? -dist : dist;
+					}
+				}
+			}
+		}
+
+		// samples beyond band of every triangle take the side of a
+		// neighbor (the band is contiguous, so a few passes reach them)
+		//
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (int s = 0; s < brickSamples; s++) {
+				if (!isnan(d[s])) continue;
+				int x = s % brickSide, y = (s / brickSide) % brickSide, z = s / (brickSide * brickSide);
+				int nb[6] = { x > 0 ? s - 1 : -1, x < brickCells ? s + 1 : -1,
+					y > 0 ? s - brickSide : -1, y < brickCells ? s + brickSide : -1,
+					z > 0 ? s - brickSide * brickSide : -1, z < brickCells ? s + brickSide * brickSide : -1 };
+				for (int i = 0; i < 6; i++) {
+					if (nb[i] >= 0 && !isnan(d[nb[i]])) {
+						d[s] = d[nb[i]] < 0 ? -band : band;
+						changed = true;
+						break;
+					}
+				}
+			}
+		}
+		bool inBand = false;
+		for (int s = 0; s < brickSamples; s++) {
+			if (isnan(d[s])) d[s] = band;
+			if (fabsf(d[s]) < band) inBand = true;
+		}
+		if (!inBand) d.clear();
+	};
+	ThreadPool & threads = ThreadPool::shared();
+	TaskGroup group;
+	int numActive = active.size();
+	for (int i = 0; i < numActive; i += bricksPerTask) {
+		threads.submit(group, [&buildBrick, &active, i] {
+			for (int j = i; j < min((int)active.size(), i + bricksPerTask); j++)
+				buildBrick(active[j]);
+		});
+	}
+	threads.wait(group);
+
+	// pack the bricks in the band (table order, so the result does not
+	// depend on the threads); the rest keep only their side, from the
+	// nearest stored brick below them in the column (its top samples) or,
+	// under the lowest one, above them (its bottom samples)
+	//
+	brickStore.assign(numTable, outsideBrick);
+	for (int i = 0; i < numTable; i++) {
+		if (values[i].empty()) continue;
+		brickStore[i] = numBricks++;
+		sampleStore.insert(sampleStore.end(), values[i].begin(), values[i].end());
+	}
+	int mid = brickCells / 2;
+	int bottom = (mid * brickSide + 0) * brickSide + mid;
+	int top = (mid * brickSide + brickCells) * brickSide + mid;
+	for (int z = 0; z < bricksZ; z++) {
+		for (int x = 0; x < bricksX; x++) {
+			int32_t side = outsideBrick;
+			bool found = false;
+			for (int y = 0; y < bricksY; y++) {
+				int32_t b = brickStore[(z * bricksY + y) * bricksX + x];
+				if (b < 0) continue;
+				if (!found) {
+					side = sampleStore[b * brickSamples + bottom] < 0 ? insideBrick : outsideBrick;
+					for (int y2 = 0; y2 < y; y2++)
+						brickStore[(z * bricksY + y2) * bricksX + x] = side;
+					found = true;
+				}
+				side = sampleStore[b * brickSamples + top] < 0 ? insideBrick : outsideBrick;
+				for (int y2 = y + 1; y2 < bricksY && brickStore[(z * bricksY + y2) * bricksX + x] < 0; y2++)
+					brickStore[(z * bricksY + y2) * bricksX + x] = side;
+			}
+		}
+	}
+	bricks = brickStore.data();
+	samples = sampleStore.data();
+}
+
+//--------------------------------------------------------------
+//  lookup
+//
+bool TerrainSdf::sample(const Vector3 & p, float & d, Vector3 & gradient) const {
+	gradient = Vector3(0, 0, 0);
+	d = band;
+	if (bricks == NULL) return false;
+	float fx = (p.x() - origin.x()) / cell, fy = (p.y() - origin.y()) / cell, fz = (p.z() - origin.z()) / cell;
+	if (!(fx >= 0 && fz >= 0 && fx < bricksX * brickCells && fz < bricksZ * brickCells &&
+		fy < bricksY * brickCells))
+		return false;
+	int ix = (int)fx, iz = (int)fz;
+	if (!(fy >= 0)) {
+		// under the grid: the side of the bottom of the column
+		//
+		int32_t b = bricks[(iz / brickCells) * bricksY * bricksX + ix / brickCells];
+		if (b == insideBrick || (b >= 0 && samples[(size_t)b * brickSamples + ix % brickCells +
+			(iz % brickCells) * brickSide * brickSide] < 0))
+			d = -band;
+		return false;
+	}
+	int iy = (int)fy;
+	int32_t b = bricks[((iz / brickCells) * bricksY + iy / brickCells) * bricksX + ix / brickCells];
+	if (b < 0) {
+		d = b == insideBrick ? -band : band;
+		return false;
+	}
+
+	// trilinear blend of the cell's 8 corners, and its derivative
+	//
+	float tx = fx - ix, ty = fy - iy, tz = fz - iz;
+	const float *s = samples + (size_t)b * brickSamples +
+		((iz % brickCells) * brickSide + iy % brickCells) * brickSide + ix % brickCells;
+	const int dy = brickSide, dz = brickSide * brickSide;
+	float c00 = s[0] + (s[1] - s[0]) * tx;
+	float c10 = s[dy] + (s[dy + 1] - s[dy]) * tx;
+	float c01 = s[dz] + (s[dz + 1] - s[dz]) * tx;
+	float c11 = s[dz + dy] + (s[dz + dy + 1] - s[dz + dy]) * tx;
+	float c0 = c00 + (c10 - c00) * ty;
+	float c1 = c01 + (c11 - c01) * ty;
+	d = c0 + (c1 - c0) * tz;
+
+	float gx0 = (s[1] - s[0]) + ((s[dy + 1] - s[dy]) - (s[1] - s[0])) * ty;
+	float gx1 = (s[dz + 1] - s[dz]) + ((s[dz + dy + 1] - s[dz + dy]) - (s[dz + 1] - s[dz])) * ty;
+	float gy0 = c10 - c00, gy1 = c11 - c01;
+	gradient = Vector3(gx0 + (gx1 - gx0) * tz, gy0 + (gy1 - gy0) * tz, c1 - c0) * (1 / cell);
+	return fabsf(d) < band;
+}
+
+float TerrainSdf::distance(const Vector3 & p) const {
+	float d;
+	Vector3 g;
+	sample(p, d, g);
+	return d;
+}
+
+//  surface normal near p (the distance gradient); up where p is outside
+//  the band
+//
+Vector3 TerrainSdf::normal(const Vector3 & p) const {
+	float d;
+	Vector3 g;
+	if (!sample(p, d, g) || g.length() == 0) return Vector3(0, 1, 0);
+	g.normalize();
+	return g;
+}
+
+//--------------------------------------------------------------
+//  cache file
+//
+//  Header, then the brick table and the samples, each aligned to 64
+//  bytes; load() maps the file and reads the bricks in place.  The header
+//  holds the mesh hash and the build settings asked for; a cache that
+//  doesn't match them is ignored and rebuilt.
+//
+static const char sdfMagic[8] = { 'T', 'E', 'R', 'R', 'S', 'D', 'F', 0 };
+static const uint32_t sdfVersion = 1;
+static const uint32_t sdfByteOrder = 0x01020304;
+
+class TerrainSdfHeader {
+public:
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t meshHash;
+	float cellSetting, bandSetting;
+	float origin[3];
+	float cell, band;
+	int32_t bricksX, bricksY, bricksZ;
+	int32_t numBricks;
+	uint64_t offset[2];             // brick table, samples
+};
+
+static uint64_t sdfAlign(uint64_t n) {
+	return (n + 63) & ~(uint64_t)63;
+}
+
+bool TerrainSdf::save(const string & path, uint64_t meshHash) const {
+	TerrainSdfHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, sdfMagic, sizeof(sdfMagic));
+	header.version = sdfVersion;
+	header.byteOrder = sdfByteOrder;
+	header.meshHash = meshHash;
+	header.cellSetting = cellSetting;
+	header.bandSetting = bandSetting;
+	for (int i = 0; i < 3; i++) header.origin[i] = origin[i];
+	header.cell = cell;
+	header.band = band;
+	header.bricksX = bricksX;
+	header.bricksY = bricksY;
+	header.bricksZ = bricksZ;
+	header.numBricks = numBricks;
+
+	const void *data[2] = { bricks, samples };
+	size_t bytes[2] = { (size_t)bricksX * bricksY * bricksZ * sizeof(int32_t),
+		(size_t)numBricks * brickSamples * sizeof(float) };
+	uint64_t pos = sdfAlign(sizeof(header));
+	for (int i = 0; i < 2; i++) {
+		header.offset[i] = pos;
+		pos = sdfAlign(pos + bytes[i]);
+	}
+
+	FILE *fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) return false;
+	static const char zeros[64] = { 0 };
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	uint64_t written = sizeof(header);
+	for (int i = 0; i < 2 && ok; i++) {
+		ok = fwrite(zeros, 1, header.offset[i] - written, fp) == header.offset[i] - written;
+		if (ok && bytes[i] > 0)
+			ok = fwrite(data[i], 1, bytes[i], fp) == bytes[i];
+		written = header.offset[i] + bytes[i];
+	}
+	ok = fclose(fp) == 0 && ok;
+	if (!ok) remove(path.c_str());
+	return ok;
+}
+
+bool TerrainSdf::load(const string & path, uint64_t meshHash, float cellSize, float bandWidth) {
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(TerrainSdfHeader)) return false;
+
+	TerrainSdfHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, sdfMagic, sizeof(sdfMagic)) != 0 || header.version != sdfVersion ||
+		header.byteOrder != sdfByteOrder || header.meshHash != meshHash ||
+		header.cellSetting != cellSize || header.bandSetting != bandWidth)
+		return false;
+	uint64_t numTable = (uint64_t)header.bricksX * header.bricksY * header.bricksZ;
+	if (header.bricksX <= 0 || header.bricksY <= 0 || header.bricksZ <= 0 || header.numBricks < 0 ||
+		header.offset[0] % 64 != 0 || header.offset[1] % 64 != 0 ||
+		header.offset[0] + numTable * sizeof(int32_t) > file.size() ||
+		header.offset[1] + (uint64_t)header.numBricks * brickSamples * sizeof(float) > file.size())
+		return false;
+
+	// use the mapping in place
+	//
+	brickStore.clear();
+	sampleStore.clear();
+	cacheFile.swap(file);
+	const char *base = cacheFile.data();
+	bricks = (const int32_t *)(base + header.offset[0]);
+	samples = (const float *)(base + header.offset[1]);
+	numBricks = header.numBricks;
+	bricksX = header.bricksX;
+	bricksY = header.bricksY;
+	bricksZ = header.bricksZ;
+	origin = Vector3(header.origin[0], header.origin[1], header.origin[2]);
+	cell = header.cell;
+	band = header.band;
+	cellSetting = cellSize;
+	bandSetting = bandWidth;
+	return true;
+}
+
+//  create the field, reusing the cache file at cachePath when it was built
+//  from the same mesh with the same settings, and (re)writing it
+//  otherwise.  Returns true if the field came from the cache.
+//
+bool TerrainSdf::createCached(const OctreeCore *surface, const string & cachePath, float cellSize,
+	float bandWidth) {
+	if (surface == NULL) return false;
+	uint64_t hash = surface->cacheHash;
+	if (hash == 0) {
+		vector<Vector3> verts(surface->verts, surface->verts + surface->numVerts);
+		vector<int> indices(surface->faces, surface->faces + surface->numFaces * 3);
+		hash = OctreeCore::meshHash(verts, indices);
+	}
+	if (load(cachePath, hash, cellSize, bandWidth))
+		return true;
+	create(surface, cellSize, bandWidth);
+	if (!save(cachePath, hash))
+		cout << "Unable to write terrain distance cache " << cachePath << endl;
+	return false;
+}
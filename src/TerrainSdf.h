@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vector3.h"
+#include "OctreeCore.h"
+#include "MappedFile.h"
+
+//  TerrainSdf - signed distance to the terrain surface (positive above /
+//  outside, negative below), for clearance queries from any point: hover
+//  warnings, landing guidance, soft contact.
+//
+//  Sparse brick map: space is cut into bricks of brickCells^3 grid cells,
+//  and only bricks within band of the surface store samples, one per grid
+//  corner, with the brick's shared faces duplicated so a lookup never
+//  leaves its brick.  A lookup is a brick table read and a trilinear
+//  blend of 8 neighboring samples; the gradient of the same blend is the
+//  surface normal.  Distances are exact at the samples (closest point on
+//  the mesh, signed by the angle weighted pseudonormal) and clamped to
+//  +-band; away from the surface the brick table only keeps the side.
+//
+//  Building touches every sample within band of every triangle, so it is
+//  meant to run once: createCached() keeps the bricks in a file named by
+//  the mesh hash (as OctreeCore does) and maps it on the next launch.
+//
+class TerrainSdf {
+public:
+	static const int brickCells = 8;
+	static const int brickSide = brickCells + 1;                // samples per brick edge
+	static const int brickSamples = brickSide * brickSide * brickSide;
+
+	// build from the mesh of surface (a face mode octree); cellSize 0 is
+	// the mesh's mean edge length, band 0 is 4 cells
+	//
+	void create(const OctreeCore *surface, float cellSize = 0, float band = 0);
+	bool createCached(const OctreeCore *surface, const std::string & cachePath, float cellSize = 0,
+		float band = 0);
+	bool save(const std::string & path, uint64_t meshHash) const;
+	bool load(const std::string & path, uint64_t meshHash, float cellSize = 0, float band = 0);
+
+	// signed distance at p, clamped to +-band (beside or over the grid is
+	// clear, +band; under it, the side of the column's bottom); sample()
+	// also returns the gradient (zero, and false, where p is outside the
+	// band)
+	//
+	float distance(const Vector3 & p) const;
+	bool sample(const Vector3 & p, float & d, Vector3 & gradient) const;
+	Vector3 normal(const Vector3 & p) const;
+
+	bool empty() const { return numBricks == 0; }
+
+	// grid: cell (i, j, k) starts at origin + cell * (i, j, k); brick
+	// (bx, by, bz) is table entry (bz * bricksY + by) * bricksX + bx, the
+	// index of its samples (x fastest) or outsideBrick / insideBrick
+	//
+	static const int32_t outsideBrick = -1;
+	static const int32_t insideBrick = -2;
+	Vector3 origin = Vector3(0, 0, 0);
+	float cell = 1;
+	float band = 4;
+	int bricksX = 0, bricksY = 0, bricksZ = 0;
+	const int32_t *bricks = NULL;
+	const float *samples = NULL;
+	int numBricks = 0;              // bricks with samples
+
+	// build settings asked for (0 = default), checked against a cache
+	//
+	float cellSetting = 0, bandSetting = 0;
+
+private:
+	std::vector<int32_t> brickStore;
+	std::vector<float> sampleStore;
+	MappedFile cacheFile;
+};
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+
+// index of the worker running on this thread (-1 for non-pool threads)
+//
+static thread_local int workerIndex = -1;
+static thread_local ThreadPool *workerPool = nullptr;
+
+ThreadPool::ThreadPool(int numThreads) {
+	if (numThreads < 0) {
+		numThreads = std::thread::hardware_concurrency();
+		numThreads = numThreads > 1 ? numThreads - 1 : 0;
+	}
+	for (int i = 0; i < numThreads; i++)
+		workers.push_back(new Worker());
+	for (int i = 0; i < numThreads; i++)
+		threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		done = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	for (size_t i = 0; i < workers.size(); i++)
+		delete workers[i];
+}
+
+//  shared pool used by the octree builder and the particle system
+//
+ThreadPool & ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::TaskRing::push_back(Task && t) {
+	if (count == slots.size()) {
+		std::vector<Task> grown(slots.empty() ? 64 : 2 * slots.size());
+		for (size_t i = 0; i < count; i++)
+			grown[i] = std::move(slots[(head + i) % slots.size()]);
+		slots.swap(grown);
+		head = 0;
+	}
+	slots[(head + count) % slots.size()] = std::move(t);
+	count++;
+}
+
+ThreadPool::Task ThreadPool::TaskRing::pop_back() {
+	count--;
+	return std::move(slots[(head + count) % slots.size()]);
+}
+
+ThreadPool::Task ThreadPool::TaskRing::pop_front() {
+	Task t = std::move(slots[head]);
+	head = (head + 1) % slots.size();
+	count--;
+	return t;
+}
+
+void ThreadPool::submit(TaskGroup & group, std::function<void()> task) {
+	Task t;
+	t.fn = std::move(task);
+	t.group = &group;
+	group.pending++;
+
+	Worker *w = (workerPool == this) ? workers[workerIndex] : &callerQueue;
+	{
+		std::lock_guard<std::mutex> guard(w->lock);
+		w->tasks.push_back(std::move(t));
+	}
+	queued++;
+	if (!workers.empty()) {
+		std::lock_guard<std::mutex> guard(sleepLock);
+		wake.notify_one();
+	}
+}
+
+//  run one task: own deque first (LIFO), then steal (FIFO) from the
+//  caller queue and the other workers.  Returns false if nothing was found.
+//
+bool ThreadPool::runOne(int self) {
+	Task t;
+	bool found = false;
+
+	if (self >= 0) {
+		Worker *w = workers[self];
+		std::lock_guard<std::mutex> guard(w->lock);
+		if (!w->tasks.empty()) {
+			t = w->tasks.pop_back();
+			found = true;
+		}
+	}
+	int n = workers.size();
+	for (int i = -1; i < n && !found; i++) {
+		Worker *w = (i < 0) ? &callerQueue : workers[(self + 1 + i) % n];
+		std::lock_guard<std::mutex> guard(w->lock);
+		if (!w->tasks.empty()) {
+			t = w->tasks.pop_front();
+			found = true;
+		}
+	}
+	if (!found) return false;
+
+	queued--;
+	t.fn();
+	t.group->pending--;
+	return true;
+}
+
+void ThreadPool::wait(TaskGroup & group) {
+	int self = (workerPool == this) ? workerIndex : -1;
+	while (group.pending > 0) {
+		if (!runOne(self))
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::workerLoop(int self) {
+	workerIndex = self;
+	workerPool = this;
+	while (!done) {
+		if (runOne(self)) continue;
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return done || queued > 0; });
+	}
+}
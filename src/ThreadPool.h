@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//  TaskGroup - counts the outstanding tasks submitted under it so a caller
+//  can wait for just that batch of work.
+//
+class TaskGroup {
+public:
+	std::atomic<int> pending{0};
+};
+
+//  ThreadPool - small work-stealing task pool.  Each worker owns a deque;
+//  it pops its own work from the back and steals from the front of the
+//  other deques when idle.  Tasks submitted from a worker go to that
+//  worker's deque, so recursive (fork/join) work stays mostly local.
+//
+//  wait() runs queued tasks on the calling thread until the group is done,
+//  so tasks may submit and wait on sub-tasks without deadlocking and a
+//  pool with zero workers simply runs everything inline.
+//
+class ThreadPool {
+public:
+	ThreadPool(int numThreads = -1);      // -1 = one per core minus caller
+	~ThreadPool();
+
+	void submit(TaskGroup & group, std::function<void()> task);
+	void wait(TaskGroup & group);
+	int size() const { return workers.size(); }
+
+	static ThreadPool & shared();
+
+private:
+	struct Task {
+		std::function<void()> fn;
+		TaskGroup *group = nullptr;
+	};
+
+	// one worker's tasks: a ring buffer that only ever grows, so once it
+	// has held the largest batch, submitting allocates nothing for tasks
+	// small enough to sit inside the std::function (a capture of up to
+	// two pointers in the common standard libraries)
+	//
+	struct TaskRing {
+		std::vector<Task> slots;
+		size_t head = 0, count = 0;
+		bool empty() const { return count == 0; }
+		void push_back(Task && t);
+		Task pop_back();
+		Task pop_front();
+	};
+	struct Worker {
+		TaskRing tasks;
+		std::mutex lock;
+	};
+
+	bool runOne(int self);
+	void workerLoop(int self);
+
+	std::vector<Worker *> workers;
+	std::vector<std::thread> threads;
+	Worker callerQueue;                   // tasks submitted from non-workers
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int> queued{0};
+	std::atomic<bool> done{false};
+};
@@ -1,6 +1,13 @@
+#include <float.h>
 #include "vector3.h"
 #include "ray.h"
 #include "box.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
   
 /*
  * Ray-box intersection using IEEE numerical properties to ensure that the
@@ -35,3 +42,393 @@ bool Box::intersect(const Ray &r, float t0, float t1) const {
     tmax = tzmax;
   return ( (tmin < t1) && (tmax > t0) );
 }
+
+bool Box::intersect(const Ray &r, float t0, float t1, float &tNear, float &tFar) const {
+  float tmin, tmax, tymin, tymax, tzmin, tzmax;
+
+  tmin = (parameters[r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
+  tmax = (parameters[1-r.sign[0]].x() - r.origin.x()) * r.inv_direction.x();
+  tymin = (parameters[r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+  tymax = (parameters[1-r.sign[1]].y() - r.origin.y()) * r.inv_direction.y();
+  if ( (tmin > tymax) || (tymin > tmax) )
+    return false;
+  if (tymin > tmin)
+    tmin = tymin;
+  if (tymax < tmax)
+    tmax = tymax;
+  tzmin = (parameters[r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+  tzmax = (parameters[1-r.sign[2]].z() - r.origin.z()) * r.inv_direction.z();
+  if ( (tmin > tzmax) || (tzmin > tmax) )
+    return false;
+  if (tzmin > tmin)
+    tmin = tzmin;
+  if (tzmax < tmax)
+    tmax = tzmax;
+  if ( (tmin < t1) && (tmax > t0) ) {
+    tNear = tmin > t0 ? tmin : t0;
+    tFar = tmax < t1 ? tmax : t1;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Triangle-box overlap using the separating axis theorem, as described in:
+ *
+ *      Tomas Akenine-Moller
+ *      "Fast 3D Triangle-Box Overlap Testing"
+ *      Journal of graphics tools, 6(1):29-33, 2001
+ *
+ * Axes tested: the 3 box normals, the triangle normal and the 9 cross
+ * products of box normals with triangle edges.  Touching counts as overlap.
+ */
+
+bool Box::overlap(const Vector3 &a, const Vector3 &b, const Vector3 &c) const {
+  Vector3 center = (parameters[0] + parameters[1]) * 0.5f;
+  Vector3 half = (parameters[1] - parameters[0]) * 0.5f;
+  Vector3 v[3] = { a - center, b - center, c - center };
+
+  // box normals (triangle bounds against box)
+  for (int k = 0; k < 3; k++) {
+    float lo = fminf(v[0][k], fminf(v[1][k], v[2][k]));
+    float hi = fmaxf(v[0][k], fmaxf(v[1][k], v[2][k]));
+    if (lo > half[k] || hi < -half[k])
+      return false;
+  }
+
+  // triangle normal
+  Vector3 e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+  Vector3 n = e[0] ^ e[1];
+  float r = half.x() * fabsf(n.x()) + half.y() * fabsf(n.y()) + half.z() * fabsf(n.z());
+  if (fabsf(n * v[0]) > r)
+    return false;
+
+  // edge cross products
+  const Vector3 axisUnit[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+  for (int j = 0; j < 3; j++) {
+    for (int k = 0; k < 3; k++) {
+      Vector3 axis = axisUnit[k] ^ e[j];
+      float p0 = v[0] * axis, p1 = v[1] * axis, p2 = v[2] * axis;
+      float lo = fminf(p0, fminf(p1, p2));
+      float hi = fmaxf(p0, fmaxf(p1, p2));
+      r = half.x() * fabsf(axis.x()) + half.y() * fabsf(axis.y()) + half.z() * fabsf(axis.z());
+      if (lo > r || hi < -r)
+        return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Swept separating axis tests.  Along each axis the moving box's interval
+ * slides by motion * axis, so the times it overlaps the other shape's
+ * interval form one range; the shapes touch while all the ranges overlap,
+ * first at the latest range start, on the axis that opened last.  Same
+ * axes as the static tests, so no motion is too fast to be caught.
+ */
+
+class SweepTimes {
+  public:
+    float enter = -FLT_MAX, exit = FLT_MAX;
+    Vector3 normal = Vector3(0, 0, 0);
+
+    // box interval [-r, r] moved by d against [lo, hi] on axis l; false
+    // once the shapes cannot touch within the motion
+    bool axis(const Vector3 &l, float lo, float hi, float r, float d) {
+      if (d == 0)
+        return lo <= r && hi >= -r;
+      float t0 = d > 0 ? (lo - r) / d : (hi + r) / d;
+      float t1 = d > 0 ? (hi + r) / d : (lo - r) / d;
+      if (t0 > enter) {
+        enter = t0;
+        normal = d > 0 ? -l : l;
+      }
+      if (t1 < exit)
+        exit = t1;
+      return enter <= exit && enter <= 1 && exit >= 0;
+    }
+    bool hit(float &t, Vector3 &n) {
+      if (enter < 0 || enter > exit || normal.length() == 0)
+        return false;
+      t = enter;
+      n = normal;
+      n.normalize();
+      return true;
+    }
+};
+
+bool Box::sweep(const Vector3 &motion, const Box &box, float &t, Vector3 &normal) const {
+  Vector3 center = (parameters[0] + parameters[1]) * 0.5f;
+  Vector3 half = (parameters[1] - parameters[0]) * 0.5f;
+  const Vector3 axisUnit[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+  SweepTimes times;
+  for (int k = 0; k < 3; k++) {
+    if (!times.axis(axisUnit[k], box.parameters[0][k] - center[k], box.parameters[1][k] - center[k],
+                    half[k], motion[k]))
+      return false;
+  }
+  return times.hit(t, normal);
+}
+
+bool Box::sweep(const Vector3 &motion, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+                float &t, Vector3 &normal) const {
+  Vector3 center = (parameters[0] + parameters[1]) * 0.5f;
+  Vector3 half = (parameters[1] - parameters[0]) * 0.5f;
+  Vector3 v[3] = { a - center, b - center, c - center };
+  SweepTimes times;
+
+  // box normals
+  const Vector3 axisUnit[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+  for (int k = 0; k < 3; k++) {
+    float lo = fminf(v[0][k], fminf(v[1][k], v[2][k]));
+    float hi = fmaxf(v[0][k], fmaxf(v[1][k], v[2][k]));
+    if (!times.axis(axisUnit[k], lo, hi, half[k], motion[k]))
+      return false;
+  }
+
+  // triangle normal
+  Vector3 e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+  Vector3 n = e[0] ^ e[1];
+  float p = n * v[0];
+  float r = half.x() * fabsf(n.x()) + half.y() * fabsf(n.y()) + half.z() * fabsf(n.z());
+  if (!times.axis(n, p, p, r, motion * n))
+    return false;
+
+  // edge cross products
+  for (int j = 0; j < 3; j++) {
+    for (int k = 0; k < 3; k++) {
+      Vector3 axis = axisUnit[k] ^ e[j];
+      float p0 = v[0] * axis, p1 = v[1] * axis, p2 = v[2] * axis;
+      float lo = fminf(p0, fminf(p1, p2));
+      float hi = fmaxf(p0, fmaxf(p1, p2));
+      r = half.x() * fabsf(axis.x()) + half.y() * fabsf(axis.y()) + half.z() * fabsf(axis.z());
+      if (!times.axis(axis, lo, hi, r, motion * axis))
+        return false;
+    }
+  }
+
+  // overlapping at the start: a hit now if moving into the face (its
+  // normal turned toward the box center), so a box resting on a triangle
+  // cannot be carried through it
+  if (times.enter < 0) {
+    if (p > 0)
+      n = -n;
+    if (n.length() == 0 || motion * n >= 0)
+      return false;
+    t = 0;
+    normal = n;
+    normal.normalize();
+    return true;
+  }
+  return times.hit(t, normal);
+}
+
+Obb::Obb(const Box &local, const Vector3 &position, float yawDegrees) {
+  float r = yawDegrees * 3.14159265f / 180;
+  float c = cosf(r), s = sinf(r);
+  axis[0] = Vector3(c, 0, -s);
+  axis[1] = Vector3(0, 1, 0);
+  axis[2] = Vector3(s, 0, c);
+  Vector3 lc = local.center();
+  center = position + axis[0] * lc.x() + axis[1] * lc.y() + axis[2] * lc.z();
+  half = (local.max() - local.min()) * 0.5f;
+}
+
+bool Obb::sweep(const Vector3 &motion, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+                float &t, Vector3 &normal) const {
+  // triangle and motion in the box frame, swept as Box::sweep() does
+  Vector3 p[3] = { a - center, b - center, c - center };
+  Vector3 v[3];
+  for (int i = 0; i < 3; i++)
+    v[i] = Vector3(p[i] * axis[0], p[i] * axis[1], p[i] * axis[2]);
+  Vector3 m(motion * axis[0], motion * axis[1], motion * axis[2]);
+  Vector3 n;
+  if (!Box(-half, half).sweep(m, v[0], v[1], v[2], t, n))
+    return false;
+  normal = axis[0] * n.x() + axis[1] * n.y() + axis[2] * n.z();
+  return true;
+}
+
+Box Obb::bounds() const {
+  Vector3 e(0, 0, 0);
+  for (int i = 0; i < 3; i++)
+    e = e + Vector3(fabsf(axis[i].x()), fabsf(axis[i].y()), fabsf(axis[i].z())) * half[i];
+  return Box(center - e, center + e);
+}
+
+bool Obb::contact(const Vector3 &a, const Vector3 &b, const Vector3 &c,
+                  Vector3 &normal, float &depth, Vector3 &point) const {
+  // triangle in the box frame (box centered at the origin)
+  Vector3 p[3] = { a - center, b - center, c - center };
+  Vector3 v[3];
+  for (int i = 0; i < 3; i++)
+    v[i] = Vector3(p[i] * axis[0], p[i] * axis[1], p[i] * axis[2]);
+  if (!Box(-half, half).overlap(v[0], v[1], v[2]))
+    return false;
+
+  // face normal toward the box center, depth of the deepest corner
+  Vector3 n = (v[1] - v[0]) ^ (v[2] - v[0]);
+  if (n.length() == 0)
+    return false;
+  n.normalize();
+  float dist = -(v[0] * n);
+  if (dist < 0) {
+    n = -n;
+    dist = -dist;
+  }
+  float r = half.x() * fabsf(n.x()) + half.y() * fabsf(n.y()) + half.z() * fabsf(n.z());
+  depth = r - dist;
+
+  Vector3 corner(n.x() > 0 ? -half.x() : half.x(),
+                 n.y() > 0 ? -half.y() : half.y(),
+                 n.z() > 0 ? -half.z() : half.z());
+  Vector3 lp = corner + n * (depth * 0.5f);
+  normal = axis[0] * n.x() + axis[1] * n.y() + axis[2] * n.z();
+  point = center + axis[0] * lp.x() + axis[1] * lp.y() + axis[2] * lp.z();
+  return true;
+}
+
+void Box8::set(int i, const Box &b) {
+  minx[i] = b.parameters[0].x(); miny[i] = b.parameters[0].y(); minz[i] = b.parameters[0].z();
+  maxx[i] = b.parameters[1].x(); maxy[i] = b.parameters[1].y(); maxz[i] = b.parameters[1].z();
+  if (i >= count) count = i + 1;
+}
+
+void Ray8::set(int i, const Ray &r) {
+  ox[i] = r.origin.x(); oy[i] = r.origin.y(); oz[i] = r.origin.z();
+  ix[i] = r.inv_direction.x(); iy[i] = r.inv_direction.y(); iz[i] = r.inv_direction.z();
+  if (i >= count) count = i + 1;
+}
+
+/*
+ * Slab test per lane:  tmin = max over axes of min(ta, tb),
+ * tmax = min over axes of max(ta, tb);  hit if tmin <= tmax and the
+ * interval meets (t0, t1), matching Box::intersect().
+ */
+
+#if defined(__AVX__)
+
+static inline int slab8(__m256 ox, __m256 oy, __m256 oz, __m256 ix, __m256 iy, __m256 iz,
+                        __m256 minx, __m256 miny, __m256 minz,
+                        __m256 maxx, __m256 maxy, __m256 maxz,
+                        __m256 t0, __m256 t1, float tNear[8]) {
+  __m256 ax = _mm256_mul_ps(_mm256_sub_ps(minx, ox), ix);
+  __m256 bx = _mm256_mul_ps(_mm256_sub_ps(maxx, ox), ix);
+  __m256 ay = _mm256_mul_ps(_mm256_sub_ps(miny, oy), iy);
+  __m256 by = _mm256_mul_ps(_mm256_sub_ps(maxy, oy), iy);
+  __m256 az = _mm256_mul_ps(_mm256_sub_ps(minz, oz), iz);
+  __m256 bz = _mm256_mul_ps(_mm256_sub_ps(maxz, oz), iz);
+  __m256 tmin = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(ax, bx), _mm256_min_ps(ay, by)), _mm256_min_ps(az, bz));
+  __m256 tmax = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(ax, bx), _mm256_max_ps(ay, by)), _mm256_max_ps(az, bz));
+  __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ),
+               _mm256_and_ps(_mm256_cmp_ps(tmin, t1, _CMP_LT_OQ), _mm256_cmp_ps(tmax, t0, _CMP_GT_OQ)));
+  _mm256_storeu_ps(tNear, _mm256_max_ps(tmin, t0));
+  return _mm256_movemask_ps(hit);
+}
+
+int intersect8(const Ray &r, const Box8 &b, float t0, float t1, float tNear[8]) {
+  int mask = slab8(_mm256_set1_ps(r.origin.x()), _mm256_set1_ps(r.origin.y()), _mm256_set1_ps(r.origin.z()),
+                   _mm256_set1_ps(r.inv_direction.x()), _mm256_set1_ps(r.inv_direction.y()), _mm256_set1_ps(r.inv_direction.z()),
+                   _mm256_loadu_ps(b.minx), _mm256_loadu_ps(b.miny), _mm256_loadu_ps(b.minz),
+                   _mm256_loadu_ps(b.maxx), _mm256_loadu_ps(b.maxy), _mm256_loadu_ps(b.maxz),
+                   _mm256_set1_ps(t0), _mm256_set1_ps(t1), tNear);
+  return mask & ((1 << b.count) - 1);
+}
+
+int intersect8(const Ray8 &r, const Box &b, float t0, const float t1[8], float tNear[8]) {
+  int mask = slab8(_mm256_loadu_ps(r.ox), _mm256_loadu_ps(r.oy), _mm256_loadu_ps(r.oz),
+                   _mm256_loadu_ps(r.ix), _mm256_loadu_ps(r.iy), _mm256_loadu_ps(r.iz),
+                   _mm256_set1_ps(b.parameters[0].x()), _mm256_set1_ps(b.parameters[0].y()), _mm256_set1_ps(b.parameters[0].z()),
+                   _mm256_set1_ps(b.parameters[1].x()), _mm256_set1_ps(b.parameters[1].y()), _mm256_set1_ps(b.parameters[1].z()),
+                   _mm256_set1_ps(t0), _mm256_loadu_ps(t1), tNear);
+  return mask & ((1 << r.count) - 1);
+}
+
+#elif defined(__SSE2__)
+
+static inline int slab4(__m128 ox, __m128 oy, __m128 oz, __m128 ix, __m128 iy, __m128 iz,
+                        __m128 minx, __m128 miny, __m128 minz,
+                        __m128 maxx, __m128 maxy, __m128 maxz,
+                        __m128 t0, __m128 t1, float tNear[4]) {
+  __m128 ax = _mm_mul_ps(_mm_sub_ps(minx, ox), ix);
+  __m128 bx = _mm_mul_ps(_mm_sub_ps(maxx, ox), ix);
+  __m128 ay = _mm_mul_ps(_mm_sub_ps(miny, oy), iy);
+  __m128 by = _mm_mul_ps(_mm_sub_ps(maxy, oy), iy);
+  __m128 az = _mm_mul_ps(_mm_sub_ps(minz, oz), iz);
+  __m128 bz = _mm_mul_ps(_mm_sub_ps(maxz, oz), iz);
+  __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)), _mm_min_ps(az, bz));
+  __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)), _mm_max_ps(az, bz));
+  __m128 hit = _mm_and_ps(_mm_cmple_ps(tmin, tmax),
+               _mm_and_ps(_mm_cmplt_ps(tmin, t1), _mm_cmpgt_ps(tmax, t0)));
+  _mm_storeu_ps(tNear, _mm_max_ps(tmin, t0));
+  return _mm_movemask_ps(hit);
+}
+
+int intersect8(const Ray &r, const Box8 &b, float t0, float t1, float tNear[8]) {
+  __m128 ox = _mm_set1_ps(r.origin.x()), oy = _mm_set1_ps(r.origin.y()), oz = _mm_set1_ps(r.origin.z());
+  __m128 ix = _mm_set1_ps(r.inv_direction.x()), iy = _mm_set1_ps(r.inv_direction.y()), iz = _mm_set1_ps(r.inv_direction.z());
+  __m128 vt0 = _mm_set1_ps(t0), vt1 = _mm_set1_ps(t1);
+  int mask = 0;
+  for (int i = 0; i < b.count; i += 4) {
+    mask |= slab4(ox, oy, oz, ix, iy, iz,
+                  _mm_loadu_ps(b.minx + i), _mm_loadu_ps(b.miny + i), _mm_loadu_ps(b.minz + i),
+                  _mm_loadu_ps(b.maxx + i), _mm_loadu_ps(b.maxy + i), _mm_loadu_ps(b.maxz + i),
+                  vt0, vt1, tNear + i) << i;
+  }
+  return mask & ((1 << b.count) - 1);
+}
+
+int intersect8(const Ray8 &r, const Box &b, float t0, const float t1[8], float tNear[8]) {
+  __m128 minx = _mm_set1_ps(b.parameters[0].x()), miny = _mm_set1_ps(b.parameters[0].y()), minz = _mm_set1_ps(b.parameters[0].z());
+  __m128 maxx = _mm_set1_ps(b.parameters[1].x()), maxy = _mm_set1_ps(b.parameters[1].y()), maxz = _mm_set1_ps(b.parameters[1].z());
+  __m128 vt0 = _mm_set1_ps(t0);
+  int mask = 0;
+  for (int i = 0; i < r.count; i += 4) {
+    mask |= slab4(_mm_loadu_ps(r.ox + i), _mm_loadu_ps(r.oy + i), _mm_loadu_ps(r.oz + i),
+                  _mm_loadu_ps(r.ix + i), _mm_loadu_ps(r.iy + i), _mm_loadu_ps(r.iz + i),
+                  minx, miny, minz, maxx, maxy, maxz,
+                  vt0, _mm_loadu_ps(t1 + i), tNear + i) << i;
+  }
+  return mask & ((1 << r.count) - 1);
+}
+
+#else
+
+static inline bool slab1(float ox, float oy, float oz, float ix, float iy, float iz,
+                         float minx, float miny, float minz,
+                         float maxx, float maxy, float maxz,
+                         float t0, float t1, float &tNear) {
+  float ax = (minx - ox) * ix, bx = (maxx - ox) * ix;
+  float ay = (miny - oy) * iy, by = (maxy - oy) * iy;
+  float az = (minz - oz) * iz, bz = (maxz - oz) * iz;
+  float tmin = fmaxf(fmaxf(fminf(ax, bx), fminf(ay, by)), fminf(az, bz));
+  float tmax = fminf(fminf(fmaxf(ax, bx), fmaxf(ay, by)), fmaxf(az, bz));
+  tNear = fmaxf(tmin, t0);
+  return tmin <= tmax && tmin < t1 && tmax > t0;
+}
+
+int intersect8(const Ray &r, const Box8 &b, float t0, float t1, float tNear[8]) {
+  int mask = 0;
+  for (int i = 0; i < b.count; i++) {
+    if (slab1(r.origin.x(), r.origin.y(), r.origin.z(),
+              r.inv_direction.x(), r.inv_direction.y(), r.inv_direction.z(),
+              b.minx[i], b.miny[i], b.minz[i], b.maxx[i], b.maxy[i], b.maxz[i],
+              t0, t1, tNear[i]))
+      mask |= 1 << i;
+  }
+  return mask;
+}
+
+int intersect8(const Ray8 &r, const Box &b, float t0, const float t1[8], float tNear[8]) {
+  int mask = 0;
+  for (int i = 0; i < r.count; i++) {
+    if (slab1(r.ox[i], r.oy[i], r.oz[i], r.ix[i], r.iy[i], r.iz[i],
+              b.parameters[0].x(), b.parameters[0].y(), b.parameters[0].z(),
+              b.parameters[1].x(), b.parameters[1].y(), b.parameters[1].z(),
+              t0, t1[i], tNear[i]))
+      mask |= 1 << i;
+  }
+  return mask;
+}
+
+#endif
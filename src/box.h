@@ -25,37 +25,125 @@ class Box {
     }
     // (t0, t1) is the interval for valid hits
     bool intersect(const Ray &, float t0, float t1) const;
+    // same test, also returns the entry/exit distances clipped to (t0, t1)
+    bool intersect(const Ray &, float t0, float t1, float &tNear, float &tFar) const;
 
     // corners
     Vector3 parameters[2];
 
-	Vector3 min() { return parameters[0]; }
-	Vector3 max() { return parameters[1]; }
-	const bool inside(const Vector3 &p) {
+	Vector3 min() const { return parameters[0]; }
+	Vector3 max() const { return parameters[1]; }
+	bool inside(const Vector3 &p) const {
 		return ((p.x() >= parameters[0].x() && p.x() <= parameters[1].x()) &&
 		     	(p.y() >= parameters[0].y() && p.y() <= parameters[1].y()) &&
 			    (p.z() >= parameters[0].z() && p.z() <= parameters[1].z()));
 	}
-	const bool inside(Vector3 *points, int size) {
+	bool inside(const Vector3 *points, int size) const {
 		bool allInside = true;
 		for (int i = 0; i < size; i++) {
-			if (!inside(points[i])) allInside = false;
-			break;
+			if (!inside(points[i])) {
+				allInside = false;
+				break;
+			}
 		}
 		return allInside;
 	}
 
     
     //check if two boxes overlap
-    bool overlap(const Box &box) {
+    bool overlap(const Box &box) const {
         return ((box.parameters[0].x() <= max().x() && box.parameters[1].x() >= min().x()) &&
                  (box.parameters[0].y() <= max().y() && box.parameters[1].y() >= min().y()) &&
                  (box.parameters[0].z() <= max().z() && box.parameters[1].z() >= min().z()));
     }
 
-	Vector3 center() {
+    //check if triangle (a, b, c) overlaps box (separating axis test)
+    bool overlap(const Vector3 &a, const Vector3 &b, const Vector3 &c) const;
+
+    // swept tests: this box moved by motion against a static box or
+    // triangle.  True if they first touch at some t in [0, 1] of the
+    // motion; t is that time and normal the separating axis they meet
+    // on, facing against the motion.  Already overlapping a box at the
+    // start is not a hit (that is a contact, see Obb::contact()); already
+    // overlapping a triangle is a hit at t = 0 if the motion goes into
+    // it (against its normal turned toward the box center).
+    bool sweep(const Vector3 &motion, const Box &box, float &t, Vector3 &normal) const;
+    bool sweep(const Vector3 &motion, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+               float &t, Vector3 &normal) const;
+
+	Vector3 center() const {
 		return ((max() - min()) / 2 + min());
 	}
 };
 
+/*
+ * Oriented box: a center, three unit axes and the half size along each.
+ * contact() is the separating axis test against a triangle (the triangle
+ * moved into the box frame and tested with Box::overlap()); on overlap it
+ * also returns the triangle normal (turned toward the box center), the
+ * depth of the box below the triangle plane along it, and a contact
+ * point halfway into the overlap under the deepest corner.  sweep() is
+ * Box::sweep() in the box frame: the oriented box moved against a
+ * triangle, not its looser world bounds.
+ */
+
+class Obb {
+  public:
+    Obb() { }
+    // box given in the local frame of an object at position, turned yaw
+    // degrees about +y (as ofNode / ofxAssimpModelLoader rotate)
+    Obb(const Box &local, const Vector3 &position, float yawDegrees);
+
+    Vector3 center;
+    Vector3 axis[3];
+    Vector3 half;
+
+    // world axis-aligned bounds
+    Box bounds() const;
+    bool contact(const Vector3 &a, const Vector3 &b, const Vector3 &c,
+                 Vector3 &normal, float &depth, Vector3 &point) const;
+    bool sweep(const Vector3 &motion, const Vector3 &a, const Vector3 &b, const Vector3 &c,
+               float &t, Vector3 &normal) const;
+};
+
+/*
+ * Batched ray-box tests in structure-of-arrays form.  Box8 holds up to
+ * eight boxes (one octree child block), Ray8 up to eight rays.  The
+ * kernels use AVX or SSE when the compiler targets them and fall back to
+ * scalar code otherwise.  They return a bit mask of the lanes that hit in
+ * (t0, t1) and the clipped entry distance of each hit lane in tNear.
+ */
+
+class Box8 {
+  public:
+    Box8() : count(0) {
+      for (int i = 0; i < 8; i++)
+        minx[i] = miny[i] = minz[i] = maxx[i] = maxy[i] = maxz[i] = 0;
+    }
+    void set(int i, const Box &b);
+
+    float minx[8], miny[8], minz[8];
+    float maxx[8], maxy[8], maxz[8];
+    int count;
+};
+
+class Ray8 {
+  public:
+    Ray8() : count(0) {
+      for (int i = 0; i < 8; i++)
+        ox[i] = oy[i] = oz[i] = ix[i] = iy[i] = iz[i] = 0;
+    }
+    void set(int i, const Ray &r);
+
+    float ox[8], oy[8], oz[8];      // origins
+    float ix[8], iy[8], iz[8];      // inverse directions
+    int count;
+};
+
+// one ray against (up to) eight boxes
+int intersect8(const Ray &, const Box8 &, float t0, float t1, float tNear[8]);
+
+// (up to) eight rays against one box; t1 is per ray
+int intersect8(const Ray8 &, const Box &, float t0, const float t1[8], float tNear[8]);
+
 #endif // _BOX_H_
@@ -53,10 +53,57 @@ void ofApp::setup(){
     //moon.setRotation(0, -15, 1, 0, 0);      //flatten moon obj. file
 
 
-	//  Create Octree for testing.
+	//  Create Octree for testing.  (set bParallel = false to time the
+	//  serial build, or buildType = MortonBuild for the Z-order builder)
+	//  The built tree is cached next to the model and reused on the next
+	//  launch; delete the .octree file to force a rebuild.
 	//
-	octree.create(moon.getMesh(0), 20);
-	
+	octree.bParallel = true;
+	float t1 = ofGetElapsedTimeMillis();
+	bool cached = octree.createCached(moon.getMesh(0), 20, ofToDataPath("geo/moon-low-v1.octree"));
+	float t2 = ofGetElapsedTimeMillis();
+	cout << "Time to Create Octree: " << t2 - t1 << " millisec"
+		<< (cached ? " (cached)" : octree.buildType == MortonBuild ? " (morton)" :
+			octree.bParallel ? " (parallel)" : " (serial)") << endl;
+
+
+	//  triangle octree of the terrain surface (used by the AGL sensor)
+	//
+	terrain.bUseFaces = true;
+	terrain.bParallel = true;
+	terrain.createCached(moon.getMesh(0), 12, ofToDataPath("geo/moon-low-v1-faces.octree"));
+
+	//  height grid of the terrain: altitude under any point without a
+	//  ray cast (overhangs still go through the terrain octree)
+	//
+	t1 = ofGetElapsedTimeMillis();
+	ground.create(&terrain);
+	t2 = ofGetElapsedTimeMillis();
+	cout << "Time to Create Heightfield: " << t2 - t1 << " millisec (" << ground.numX << " x " << ground.numZ
+		<< ", " << ground.numFallback << " cells use the octree)" << endl;
+
+	//  distance field of the terrain (proximity warning), built once and
+	//  cached next to the model like the octrees
+	//
+	t1 = ofGetElapsedTimeMillis();
+	cached = field.createCached(&terrain, ofToDataPath("geo/moon-low-v1.sdf"));
+	t2 = ofGetElapsedTimeMillis();
+	cout << "Time to Create Terrain SDF: " << t2 - t1 << " millisec" << (cached ? " (cached)" : "") << " ("
+		<< field.numBricks << " bricks)" << endl;
+
+	//  lander physics runs against the point octree and the terrain octree
+	//  (contact); altitude comes from the height grid, clearance from the
+	//  distance field
+	//
+	sim.landerScale = landerScale;
+	sim.setTerrain(&octree, &terrain, &ground, &field);
+	sim.reset((uint64_t)ofRandom(1, 1e9));
+
+	//  exhaust / explosion particles come from a fixed pool (no allocation
+	//  while playing); a burst past the cap replaces the oldest particles
+	//
+	emitter.sys->setCapacity(2000, DropOldest);
+
 	cout << "Number of Verts: " << moon.getMesh(0).getNumVertices() << endl;
     
     //set lander position default
@@ -69,7 +116,7 @@ void ofApp::setup(){
 
         
         //lander.setPosition(1, 1, 0);
-        lander.setPosition(position.x, position.y, position.z);     //set back terrain
+        lander.setPosition(sim.position.x(), sim.position.y(), sim.position.z());     //set back terrain
         
         bLanderLoaded = true;
         bboxList.clear();
@@ -84,6 +131,7 @@ void ofApp::setup(){
         glm::vec3 min = lander.getSceneMin(landerScale);        //scale
         glm::vec3 max = lander.getSceneMax(landerScale);
         landerBounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
+        sim.bounds = landerBounds;
         
         //load landerLight
         landerLight.setup();
@@ -120,6 +168,14 @@ void ofApp::setup(){
     else
         cout << "Error: Can't load model" << endl;
     
+    session.begin(sim, physicsClock.step, &octree, &terrain);       //start recording
+}
+
+//--------------------------------------------------------------
+// save the session recording on the way out
+//
+void ofApp::exit() {
+    saveSession();
 }
  
 //--------------------------------------------------------------
@@ -131,21 +187,28 @@ void ofApp::update() {
     emitter.setCurrPos(lander.getPosition());
     
     //upon game start...can pause and select lander position
-    if(gameStart) {
+    if(sim.running) {
         
-        checkCollisions(forces);
-        if(fuel <= 0) {
-            gameStart = false;
-            gameOver = true;
-            cout << "OUT OF FUEL";
+        //contact, fuel and integration in fixed steps for the real time that passed
+        int steps = physicsClock.advance(ofGetLastFrameTime());
+        for(int i = 0; i < steps && sim.running; i++) {
+            LanderEvent event = sim.step(physicsClock.step);
+            if(event == LanderCrashed) {
+                emitter.setEmitterType(RadialEmitter);
+                emitter.start();            //explosion once
+                emitter.setOneShot(true);
+            }
+            else if(event == LanderOutOfFuel) {
+                cout << "OUT OF FUEL";
+            }
         }
-
         
+        clearance = sim.clearance();        //closest approach to the terrain
         
-        //position, velocity, degVelocity, degAcceleration, rotation deg, force deg
-        updateForce(position, velocity, rotation, degVeloc, degForce);
-        lander.setPosition(position.x, position.y, position.z);     //set new position
-        lander.setRotation(0, rotation, 0, 1, 0);       //set new rotation
+        //draw in between the last two steps (or where it is being dragged)
+        Vector3 drawPos = landerDrag.active ? landerDrag.position : sim.drawPosition(physicsClock.alpha());
+        lander.setPosition(drawPos.x(), drawPos.y(), drawPos.z());     //set new position
+        lander.setRotation(0, sim.drawRotation(physicsClock.alpha()), 0, 1, 0);       //set new rotation
         
         //switch based on camType - Brian L
         //
@@ -157,7 +220,7 @@ void ofApp::update() {
                 break;
             case rotateCam:
                 cam.setPosition(lander.getPosition() + ofVec3f(0, -0.1, 0));      //rotate based on UP vector
-                cam.rotateDeg(degVeloc / ofGetFrameRate(), ofVec3f(0, 1, 0));
+                cam.rotateDeg(sim.degVeloc * ofGetLastFrameTime(), ofVec3f(0, 1, 0));
                 break;
             case groundCam:
                 cam.setPosition(lander.getPosition());      //set at position
@@ -179,20 +242,22 @@ void ofApp::update() {
             landerLight.disable();
         
         
-        if(aglON)
+        if(aglON) {
             aglSensor(landerPoint);     //telemetric sensor
+            legSensors();               //landing leg probes
+        }
         
         //check game status
-        if(gameOver) {
+        if(sim.crashed) {
             status = "FAILED. PRESS = to RESTART.";      //display message
             statColor = ofColor::red;
         }
-        else if(gameWin) {
+        else if(sim.landed) {
             status = "SUCCESS. PRESS = to PLAY AGAIN.";      //display message
             statColor = ofColor::green;
         }
-    }           //end gameStart
-    else if(gameOver) {     //lander K'BOOM
+    }           //end running
+    else if(sim.crashed) {     //lander K'BOOM
         ofVec3f random = lander.getPosition() + ofVec3f(ofRandom(0, 1), ofRandom(0, 1), ofRandom(0, 1));
         lander.setPosition(random.x, random.y, random.z);     //set new position
         lander.setRotation(1, ofRandom(-10, 10), ofRandom(0, 1), ofRandom(0, 1), ofRandom(0, 1));       //set new rotation
@@ -225,9 +290,22 @@ void ofApp::draw() {
 
     //fuel display
     string str2;
-    str2 += "Fuel: " + std::to_string(fuel);
+    str2 += "Fuel: " + std::to_string(sim.fuel);
     ofDrawBitmapString(str2, 0, 30);
 
+    //clearance display (closest point of the lander to the terrain),
+    //with a warning inside half the distance field's band
+    if (!field.empty()) {
+        string str3 = "Clearance: ";
+        str3 += clearance < field.band ? std::to_string(clearance) : "> " + std::to_string(field.band);
+        ofDrawBitmapString(str3, 0, 45);
+        if (clearance < field.band / 2 && !sim.landed && !sim.crashed) {
+            ofSetColor(ofColor::orange);
+            ofDrawBitmapString("TERRAIN PROXIMITY", 0, 60);
+            ofSetColor(ofColor::white);
+        }
+    }
+
 	cam.begin();
     
     //matrix to perform background starfield - Brian L
@@ -275,8 +353,19 @@ void ofApp::draw() {
             // draw colliding boxes
             //
             ofSetColor(ofColor::lightBlue);
-            for (int i = 0; i < colBoxList.size(); i++) {
-                Octree::drawBox(colBoxList[i]);
+            for (int i = 0; i < sim.collision.boxes.size(); i++) {
+                Octree::drawBox(sim.collision.boxes[i]);
+            }
+            
+            //terrain leaves under the lander and the contact normals
+            for (int i = 0; i < sim.contacts.boxes.size(); i++) {
+                Octree::drawBox(sim.contacts.boxes[i]);
+            }
+            ofSetColor(ofColor::yellow);
+            for (int i = 0; i < sim.contacts.contacts.size(); i++) {
+                const OctreeContact &c = sim.contacts.contacts[i];
+                ofVec3f p = ofVec3f(c.point.x(), c.point.y(), c.point.z());
+                ofDrawLine(p, p + ofVec3f(c.normal.x(), c.normal.y(), c.normal.z()));
             }
         }
     }
@@ -312,7 +401,7 @@ void ofApp::draw() {
 	// if point selected, draw a sphere
 	//
 	if (pointSelected) {
-		ofVec3f p = octree.mesh.getVertex(selectedNode.points[0]);
+		ofVec3f p = ofVec3f(selectedHit.point.x(), selectedHit.point.y(), selectedHit.point.z());
 		ofVec3f d = p - cam.getPosition();
 		ofSetColor(ofColor::lightBlue);
 		ofDrawSphere(p, .02 * d.length());
@@ -322,12 +411,20 @@ void ofApp::draw() {
     //
     if(aglON) {
         if (aglSelected) {
-            ofVec3f a = octree.mesh.getVertex(aglNode.points[0]);
+            ofVec3f a = landerPoint;
             ofVec3f b = a - lander.getPosition();
             ofSetColor(ofColor::orangeRed);
             ofDrawLine(lander.getPosition(), landerPoint);
             ofDrawSphere(a, .02 * b.length());
         }
+        
+        //landing leg probes
+        for (int i = 0; i < legHits.size(); i++) {
+            if (legHits[i].node < 0) continue;
+            Vector3 o = legRays[i].origin;
+            Vector3 p = legHits[i].point;
+            ofDrawLine(ofVec3f(o.x(), o.y(), o.z()), ofVec3f(p.x(), p.y(), p.z()));
+        }
     }
 
 	ofPopMatrix();
@@ -358,7 +455,8 @@ void ofApp::keyPressed(int key) {
             cam.setTarget(lander.getPosition());        //target land position once
             break;
         case ' ':
-            gameStart = !gameStart;       //start game toggle w/ spacebar
+            sim.running = !sim.running;       //start game toggle w/ spacebar
+            session.running(sim);
             break;
         case 'A':
         case 'a':
@@ -366,49 +464,31 @@ void ofApp::keyPressed(int key) {
             break;
         case 'W':
         case 'w':
-            fuel--;                     //fuel reduction
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(0, 0, 5);
+            landerInput(ThrustForward);
             break;
         case 'S':
         case 's':
-            fuel--;
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(0, 0, -5);
+            landerInput(ThrustBack);
             break;
         case OF_KEY_UP:
-            fuel -= 2;
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(0, 5, 0);     //scaled UP thrust force
+            landerInput(ThrustUp);     //scaled UP thrust force
             break;
         case OF_KEY_DOWN:
-            fuel--;
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(0, -5, 0);     //scaled DOWN thrust force
+            landerInput(ThrustDown);     //scaled DOWN thrust force
             break;
         case OF_KEY_RIGHT:
-            fuel--;
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(-5, 0, 0);     //scaled RIGHT thrust force
+            landerInput(ThrustRight);     //scaled RIGHT thrust force
             break;
         case OF_KEY_LEFT:
-            fuel--;
-            emitter.start();           //start emitter and one shot
-            emitter.setOneShot(true);
-            forces += ofVec3f(5, 0, 0);     //scaled LEFT thrust force
+            landerInput(ThrustLeft);     //scaled LEFT thrust force
             break;
         case 'Q':
         case 'q':
-            degForce = -75;     //forward rotation force
+            landerInput(RotateForward);     //forward rotation force
             break;
         case 'E':
         case 'e':
-            degForce += 75;       //backward rotation force
+            landerInput(RotateBack);       //backward rotation force
             break;
         case 'B':
         case 'b':
@@ -466,25 +546,21 @@ void ofApp::togglePointsDisplay() {
 void ofApp::keyReleased(int key) {
     
     //UI messages
-    if(gameStart && key == ' ') {
+    if(sim.running && key == ' ') {
         statColor = ofColor::yellow;
         status = "LAND SAFELY";
     }
-    else if (!gameStart && key == ' ') {
+    else if (!sim.running && key == ' ') {
         statColor = ofColor::white;
         status = "PAUSED";
     }
-    else if ((gameWin || gameOver) && key == '=') {
-        gameWin = false;
-        gameOver = false;
-        gameStart = true;
-        fuel = 250;
-        position = startingPosition;
-        rotation = 0;
+    else if ((sim.landed || sim.crashed) && key == '=') {
+        saveSession();
+        sim.reset((uint64_t)ofRandom(1, 1e9));
+        session.begin(sim, physicsClock.step, &octree, &terrain);
         statColor = ofColor::yellow;
         status = "LAND SAFELY";
         emitter.setEmitterType(DirectionalEmitter);
-        impulseForce.set(0, 0, 0);
     }
     
 	switch (key) {
@@ -538,6 +614,7 @@ void ofApp::mousePressed(int x, int y, int button) {
 			mouseDownPos = getMousePointOnPlane(lander.getPosition(), cam.getZAxis());
 			mouseLastPos = mouseDownPos;
 			bInDrag = true;
+			landerDrag.press(sim);
 		}
 		else {
 			bLanderSelected = false;
@@ -556,10 +633,10 @@ bool ofApp::raySelectWithOctree(ofVec3f &pointRet) {
 	Ray ray = Ray(Vector3(rayPoint.x, rayPoint.y, rayPoint.z),
 		Vector3(rayDir.x, rayDir.y, rayDir.z));
 
-	pointSelected = octree.intersect(ray, octree.root, selectedNode);
+	pointSelected = octree.closestHit(ray, selectedHit);      //nearest point along ray
 
 	if (pointSelected) {
-		pointRet = octree.mesh.getVertex(selectedNode.points[0]);       //point selected returned
+		pointRet = ofVec3f(selectedHit.point.x(), selectedHit.point.y(), selectedHit.point.z());       //point selected returned
 	}
 	return pointSelected;
 }
@@ -576,11 +653,12 @@ void ofApp::mouseDragged(int x, int y, int button) {
 
 	if (bInDrag) {
 
-		glm::vec3 landerPos = lander.getPosition();
+		glm::vec3 landerPos(landerDrag.position.x(), landerDrag.position.y(), landerDrag.position.z());
 
 		glm::vec3 mousePos = getMousePointOnPlane(landerPos, cam.getZAxis());
 		glm::vec3 delta = mousePos - mouseLastPos;
 	
+		landerDrag.drag(Vector3(delta.x, delta.y, delta.z));
 		landerPos += delta;
 		lander.setPosition(landerPos.x, landerPos.y, landerPos.z);
 		mouseLastPos = mousePos;
@@ -590,8 +668,7 @@ void ofApp::mouseDragged(int x, int y, int button) {
 
 		Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
 
-		colBoxList.clear();
-		octree.intersect(bounds, octree.root, colBoxList);
+		sim.collision.query(bounds);
 
 
 	}
@@ -603,8 +680,10 @@ void ofApp::mouseDragged(int x, int y, int button) {
 //--------------------------------------------------------------
 void ofApp::mouseReleased(int x, int y, int button) {
 	bInDrag = false;
-    //assign new position as lander position upon release after game pause
-    position = lander.getPosition();
+    //drop the lander where it was dragged to; a click, a camera drag or
+    //a gui click leaves the sim where it is
+    if(landerDrag.release(sim))
+        session.move(sim);
     bLanderSelected = false;        //erase drawing bounds
 }
 
@@ -639,95 +718,45 @@ void ofApp::gotMessage(ofMessage msg){
 
 }
 
-//update the forces acting upon the lander
-void ofApp::updateForce(ofVec3f &p, ofVec3f &v, float &r, float &rv, float &f) {
-
-    // update position based on velocity
-    //
-    p += (v / ofGetFrameRate());
-    r += (rv / 60);    //rotation
-
-    // update acceleration with accumulated particles forces
-    // remember :  (f = ma) OR (a = 1/m * f)
-    //
-    ofVec3f accel = acceleration;    // start with any acceleration already on the particle
-    accel += (forces * (1.0 / mass));
-    
-    //rotation
-    float rcel = degAccel;
-    rcel += f;
-    
-    v += (accel / ofGetFrameRate());
-    rv += (rcel / 60);     //rotation
-    
-    // add a little damping for good measure
-    //
-    v *= damping;
-    rv *= degDamp;
-    
-    
-    //reset all forces on lander by setting it to gravity + turbulent forces
-    //
-    forces.set(gravityForce + turbulentForce);      //turbulence and gravity default
-
-    
-    f = 0;      //rotational force set to 0
-    
-}
-
-
-//check for collisions (impulse force)
-void ofApp::checkCollisions(ofVec3f &imp) {
-    ofVec3f min = lander.getSceneMin(landerScale) + lander.getPosition();
-    ofVec3f max = lander.getSceneMax(landerScale) + lander.getPosition();
-
-    Box bounds = Box(Vector3(min.x, min.y, min.z), Vector3(max.x, max.y, max.z));
-    if(octree.intersect(bounds, octree.root, colBoxList)) {
-        ofVec3f norm = ofVec3f(0, 1, 0);
-        
-        //force = (restitution + 1) * (-vdotn) * n
-        imp = (restitution + 1.0) * (dot(-velocity, norm)) * norm;
-        forces += (imp * ofGetFrameRate());       //add to forces
-        
-        if(imp.y > winCon) {
-            gameOver = true;        //if impulse force is greater than designated value
-            gameStart = false;
-            emitter.setEmitterType(RadialEmitter);
-            emitter.start();            //explosion once
-            emitter.setOneShot(true);
-        }
-        else {
-            gameWin = true;
-        }
-        
+//pilot command: forces/fuel go to the sim, thrusters fire the exhaust
+void ofApp::landerInput(LanderInput input) {
+    session.input(sim, input);
+    if(sim.apply(input)) {
+        emitter.start();           //start emitter and one shot
+        emitter.setOneShot(true);
     }
 }
 
-float ofApp::dot(ofVec3f obj1, ofVec3f obj2) {
-    return ((obj1.x * obj2.x) + (obj1.y * obj2.y) + (obj1.z * obj2.z));
-}
-
 
 //alteration of raySelectWithOctree: replace w/ lander position
 void ofApp::aglSensor(ofVec3f &pointRet) {
-    ofVec3f origin = lander.getPosition();      //position of lander
-    ofVec3f rayPoint = origin + ofVec3f(0, -100, 0);       //downward sensor
-    ofVec3f rayDir = rayPoint - origin;
-    rayDir.normalize();
-    
-    //create ray
-    Ray ray = Ray(Vector3(rayPoint.x, rayPoint.y, rayPoint.z), Vector3(rayDir.x, rayDir.y, rayDir.z));
-    
-    aglSelected = octree.intersect(ray, octree.root, aglNode);      //call intersect function
+    aglSelected = sim.groundHit(aglHit);      //terrain surface below lander
     
     if(aglSelected) {
-        pointRet = octree.mesh.getVertex(aglNode.points[0]);
+        pointRet = ofVec3f(aglHit.point.x(), aglHit.point.y(), aglHit.point.z());
     }
     //else
         //pointRet = ofVec3f(0, -100, 0);
     
 }
 
+//ground below each bottom corner of the lander bounds (height grid
+//lookups, so probes are cheap)
+void ofApp::legSensors() {
+    ofVec3f min = lander.getSceneMin(landerScale) + lander.getPosition();
+    ofVec3f max = lander.getSceneMax(landerScale) + lander.getPosition();
+    
+    legRays.clear();
+    legRays.push_back(Ray(Vector3(min.x, min.y, min.z), Vector3(0, -1, 0)));
+    legRays.push_back(Ray(Vector3(max.x, min.y, min.z), Vector3(0, -1, 0)));
+    legRays.push_back(Ray(Vector3(max.x, min.y, max.z), Vector3(0, -1, 0)));
+    legRays.push_back(Ray(Vector3(min.x, min.y, max.z), Vector3(0, -1, 0)));
+    
+    legHits.resize(legRays.size());
+    for (int i = 0; i < legRays.size(); i++)
+        ground.groundHit(legRays[i].origin, legHits[i]);
+}
+
 
 
 //--------------------------------------------------------------
@@ -811,3 +840,15 @@ glm::vec3 ofApp::getMousePointOnPlane(glm::vec3 planePt, glm::vec3 planeNorm) {
 	}
 	else return glm::vec3(0, 0, 0);
 }
+
+//write the current session recording to data/sessions (if anything happened)
+void ofApp::saveSession() {
+    session.finish(sim);
+    if(session.entries.empty()) return;
+    ofDirectory::createDirectory(ofToDataPath("sessions"), false, true);
+    string path = ofToDataPath("sessions/lander-" + ofGetTimestampString() + ".landerlog");
+    if(session.save(path))
+        cout << "Saved session " << path << endl;
+    else
+        cout << "Unable to write session " << path << endl;
+}
@@ -4,6 +4,11 @@
 #include "ofxGui.h"
 #include "ofxAssimpModelLoader.h"
 #include "Octree.h"
+#include "Heightfield.h"
+#include "TerrainSdf.h"
+#include "LanderSim.h"
+#include "SimClock.h"
+#include "LanderLog.h"
 #include <glm/gtx/intersect.hpp>
 #include "ParticleEmitter.h"
 #include "Particle.h"
@@ -16,6 +21,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -38,12 +44,16 @@ class ofApp : public ofBaseApp{
         ofEasyCam cam;
 		ofxAssimpModelLoader moon, lander;
 		Box boundingBox, landerBounds;
-		vector<Box> colBoxList;
 		bool bLanderSelected = false;
 		Octree octree;
-		TreeNode selectedNode;
+		Octree terrain;         //triangle (face mode) octree for surface queries
+		Heightfield ground;     //height grid of terrain for altitude queries
+		TerrainSdf field;       //distance to terrain for clearance queries
+		float clearance = FLT_MAX;
+		OctreeHit selectedHit;
 		glm::vec3 mouseDownPos, mouseLastPos;
 		bool bInDrag = false;
+		LanderDrag landerDrag;  //lander position being dragged, dropped on release
 
 
 		int numLevels = 7;
@@ -61,16 +71,11 @@ class ofApp : public ofBaseApp{
 		bool bLanderLoaded;
     
         //Brian La--------------------------------------------------------------------------------
-        //gameStart
-        bool gameStart = true;         //game start
-        bool gameOver = false;         //game over
-        bool gameWin = false;          //game win
+        //game state (sim.running / crashed / landed) and fuel live in sim
         string status = "LAND SAFELY (MIND YOUR FUEL)";
         ofColor statColor = ofColor::yellow;        //status color
         //float lastTime;
         //float currentTime;
-        int fuel = 250;         //fuel limit
-        float winCon = 5;         //collide value for success
     
     
         //background & sound
@@ -93,41 +98,27 @@ class ofApp : public ofBaseApp{
         float landerScale = 0.1;
     
     
-        //forces
-        void updateForce(ofVec3f &p, ofVec3f &v, float &r, float &rv, float &f);           //integrate method for force computations
-        ofVec3f gravityForce = ofVec3f(0, -1.64 * landerScale, 0);      //gravity
-        ofVec3f turbulentForce = ofVec3f(ofRandom(-0.0164, 0.0164), ofRandom(-0.0164, 0.0164), ofRandom(-0.0164, 0.0164));      //turbulence
+        //lander physics, fuel and win/lose rules (headless, see LanderSim.h)
+        LanderSim sim;
+        SimClock physicsClock;      //fixed 60Hz steps, independent of the frame rate
+        void landerInput(LanderInput input);       //apply pilot command (+ exhaust)
     
-        ofVec3f impulseForce = ofVec3f(0, 0, 0);            //impulse
-        float restitution = 0.5;        //bounciness
-        void checkCollisions(ofVec3f &f);       //impulse force
-        float dot(ofVec3f obj1, ofVec3f obj2);      //dot product
-    
-    
-        //angular forces
-        float rotation = 0.0;       //rotation value
-        float degVeloc = 0.0;    //velocity of rotation
-        float degAccel = 0.0;    //acceleration of rotation
-        float degForce = 0.0;   //rotation force
-        float degDamp = 0.99;    //deg damp
-        
-    
-        //physics components for lander
-        ofVec3f startingPosition = ofVec3f(0, 20, -30);
-        ofVec3f position = startingPosition;     //set back terrain
-        ofVec3f acceleration = ofVec3f(0, 0, 0);     //moon
-        ofVec3f velocity = ofVec3f(0, 0, 0);           //lander velocity
-        ofVec3f forces = gravityForce + turbulentForce;         //apply gravity force
-        float mass = 1.0;           //default mass of lander
-        float damping = 0.99;       //damp value
+        //every session is recorded (inputs by sim tick) and saved to
+        //data/sessions when the game restarts or the app quits; replay
+        //them headless with tools/landerReplay
+        LanderLog session;
+        void saveSession();
     
     
         //telemetry sensor (altitude/AGL)
         bool aglON = false;
         bool aglSelected = false;       //if selection occurs
         ofVec3f landerPoint = ofVec3f(0, -100, 0);        //landerPoint
-        TreeNode aglNode;           //node selected by agl
+        OctreeHit aglHit;           //closest terrain hit below lander
         void aglSensor(ofVec3f &pointRet);        //calculate telemetric sensor
+        vector<Ray> legRays;            //landing leg probes (height grid lookups)
+        vector<OctreeHit> legHits;
+        void legSensors();
     
     
         //exhaust particles
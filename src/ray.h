@@ -31,6 +31,32 @@ class Ray {
       sign[0] = r.sign[0]; sign[1] = r.sign[1]; sign[2] = r.sign[2];
     }
 
+    // Moller-Trumbore ray-triangle test.  On a hit in [t0, t1] returns
+    // true and the distance along the ray in t.
+    bool intersectTriangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2,
+                           float t0, float t1, float &t) const {
+      Vector3 e1 = v1 - v0;
+      Vector3 e2 = v2 - v0;
+      Vector3 p = direction ^ e2;
+      float det = e1 * p;
+      if (det > -1e-12f && det < 1e-12f)
+        return false;     // ray parallel to triangle
+      float inv = 1 / det;
+      Vector3 s = origin - v0;
+      float u = (s * p) * inv;
+      if (u < 0 || u > 1)
+        return false;
+      Vector3 q = s ^ e1;
+      float v = (direction * q) * inv;
+      if (v < 0 || u + v > 1)
+        return false;
+      float hit = (e2 * q) * inv;
+      if (hit < t0 || hit > t1)
+        return false;
+      t = hit;
+      return true;
+    }
+
     Vector3 origin;
     Vector3 direction;
     Vector3 inv_direction;
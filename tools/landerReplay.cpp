@@ -0,0 +1,132 @@
+//  landerReplay - replays recorded lander sessions (LanderLog, saved by
+//  the app in data/sessions) headless, at full speed, and checks each one
+//  ends in the state that was recorded.  Exits non zero if any session
+//  does not match, so a folder of real sessions doubles as a regression
+//  test; -repeat runs each session many times for profiling.
+//
+//      g++ -O2 -std=c++11 -pthread -I../src landerReplay.cpp
+//          ../src/{LanderLog,LanderSim,Heightfield,TerrainSdf,OctreeCore,MappedFile,ThreadPool}.cpp ../src/box.cc -o landerReplay
+//
+//  (one command line)
+//
+//      ./landerReplay -octree ../bin/data/geo/moon-low-v1.octree
+//          -faces ../bin/data/geo/moon-low-v1-faces.octree ../bin/data/sessions/*.landerlog
+//
+//  The terrain is the app's point and face octree cache files; the log
+//  names the mesh hash and level count of each tree it was recorded
+//  against, so a session only replays against the same trees.
+//
+//  options:
+//
+//      -octree file     point octree cache the sessions were recorded on
+//      -faces file      face (surface) octree cache they were recorded on
+//      -repeat n        replay each session n times (1)
+//      -v               print every session, not just mismatches
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "LanderLog.h"
+#include "OctreeCore.h"
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *eventName(LanderEvent e) {
+	switch (e) {
+	case LanderLanded: return "landed";
+	case LanderCrashed: return "crashed";
+	case LanderOutOfFuel: return "out of fuel";
+	default: return "-";
+	}
+}
+
+//  make tree the one recorded (hash 0 = none was used); false if the
+//  cache file holds another tree
+//
+static bool findTree(OctreeCore & tree, const std::string & path, uint64_t hash, int levels) {
+	if (hash == 0 || (tree.cacheHash == hash && tree.cacheLevels == levels))
+		return true;
+	return !path.empty() && tree.load(path, hash, levels);
+}
+
+static void usage() {
+	fprintf(stderr, "usage: landerReplay -octree file.octree [-faces file.octree] [-repeat n] [-v]\n"
+		"    session.landerlog ...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	std::string octreePath, facesPath;
+	int repeat = 1;
+	bool verbose = false;
+	std::vector<std::string> logs;
+	for (int i = 1; i < argc; i++) {
+		std::string opt = argv[i];
+		if (opt == "-octree" && i + 1 < argc) octreePath = argv[++i];
+		else if (opt == "-faces" && i + 1 < argc) facesPath = argv[++i];
+		else if (opt == "-repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+		else if (opt == "-v") verbose = true;
+		else if (opt[0] == '-') usage();
+		else logs.push_back(opt);
+	}
+	if (logs.empty() || repeat < 1) usage();
+
+	int failed = 0;
+	double totalTime = 0, totalSteps = 0;
+	OctreeCore terrain, surface;
+	surface.bUseFaces = true;
+	for (size_t f = 0; f < logs.size(); f++) {
+		LanderLog log;
+		if (!log.load(logs[f])) {
+			printf("%s: unable to read session\n", logs[f].c_str());
+			failed++;
+			continue;
+		}
+
+		// the terrain the session was recorded on (kept while it matches)
+		//
+		if (!findTree(terrain, octreePath, log.terrainHash, log.terrainLevels)) {
+			printf("%s: recorded on another terrain (no matching -octree)\n", logs[f].c_str());
+			failed++;
+			continue;
+		}
+		if (!findTree(surface, facesPath, log.surfaceHash, log.surfaceLevels)) {
+			printf("%s: recorded on another surface (no matching -faces)\n", logs[f].c_str());
+			failed++;
+			continue;
+		}
+
+		LanderSim sim;
+		sim.setTerrain(log.terrainHash != 0 ? &terrain : NULL, log.surfaceHash != 0 ? &surface : NULL);
+		LanderEvent event = LanderNone;
+		double t0 = now();
+		for (int r = 0; r < repeat; r++) {
+			log.setup(sim);
+			event = log.replay(sim);
+		}
+		double t1 = now();
+		totalTime += t1 - t0;
+		totalSteps += (double)sim.tick * repeat;
+
+		bool ok = log.matches(sim);
+		if (!ok) failed++;
+		if (!ok || verbose) {
+			printf("%s: %s  %d inputs, %d ticks, %s, fuel %d, %.3f ms/replay\n", logs[f].c_str(),
+				ok ? "ok" : "MISMATCH", (int)log.entries.size(), sim.tick, eventName(event), sim.fuel,
+				(t1 - t0) * 1000 / repeat);
+			if (!ok)
+				printf("    recorded tick %d pos (%g %g %g) fuel %d, replayed tick %d pos (%g %g %g) fuel %d\n",
+					log.endTick, log.endPosition.x(), log.endPosition.y(), log.endPosition.z(), log.endFuel,
+					sim.tick, sim.position.x(), sim.position.y(), sim.position.z(), sim.fuel);
+		}
+	}
+	printf("%d sessions, %d failed, %.3g steps/sec\n", (int)logs.size(), failed,
+		totalTime > 0 ? totalSteps / totalTime : 0.0);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+//  landerSweep - Monte-Carlo sweep of landing parameters, headless.  Runs
+//  N landing episodes, each with its start position, winCon, restitution,
+//  fuel, thrust and autopilot descent rate drawn from the given ranges,
+//  in parallel on the ThreadPool against one shared (read only) terrain
+//  octree, and writes one CSV row per episode plus a summary.
+//
+//      g++ -O2 -std=c++11 -pthread -I../src landerSweep.cpp
+//          ../src/{LanderSim,Heightfield,TerrainSdf,OctreeCore,MappedFile,ThreadPool}.cpp ../src/box.cc -o landerSweep
+//
+//  (one command line)
+//
+//      ./landerSweep ../bin/data/geo/moon-low-v1.obj -episodes 10000 -out sweep.csv
+//
+//  The terrain is read straight from the .obj (vertices and faces only)
+//  and its point and face octrees cached next to it (-sweep.octree,
+//  -sweep-faces.octree), so only the first run pays for the builds.
+//  Contact is the rotated lander box against the terrain triangles, as
+//  in the app (-flat: box against point octree leaves, flat ground), and
+//  the altitude queries use the height grid of the surface.  An episode
+//  is repeatable from its seed: the results do not depend on the number
+//  of threads.
+//
+//  options (ranges are lo hi, a value is drawn uniformly per episode):
+//
+//      -episodes n      number of episodes (1000)
+//      -threads n       threads to run on, caller included (all cores)
+//      -seed s          sweep seed (1)
+//      -out file        per episode CSV (sweep.csv)
+//      -levels n        octree levels (20, as the app)
+//      -flat            flat ground contact (no face octree)
+//      -steps n         step limit per episode (7200 = 2 min)
+//      -dt sec          step size (1/60)
+//      -integrator i    euler, symplectic, verlet or rk4 (euler)
+//      -size s          lander box edge, world units (1)
+//      -x / -y / -z     start position (-5 5 / 15 25 / -35 -25)
+//      -wincon          max safe impulse (0.1 0.5)
+//      -restitution     bounciness (0.5 0.5)
+//      -fuel            starting fuel (20 250)
+//      -thrust          thruster force (5 5)
+//      -descent         autopilot target descent rate, units/sec (0.05 0.3)
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Heightfield.h"
+#include "LanderSim.h"
+#include "OctreeCore.h"
+#include "ThreadPool.h"
+
+static double now() {
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+class Range {
+public:
+	float lo, hi;
+	float draw(Rng & rng) const { return lo == hi ? lo : rng.range(lo, hi); }
+};
+
+class SweepSettings {
+public:
+	int episodes = 1000;
+	int threads = 0;                    // 0 = all cores
+	uint64_t seed = 1;
+	std::string out = "sweep.csv";
+	int levels = 20;
+	bool flat = false;
+	int maxSteps = 7200;
+	float dt = 1.0 / 60;
+	IntegratorType integrator = ExplicitEuler;
+	float size = 1;
+	Range x = { -5, 5 }, y = { 15, 25 }, z = { -35, -25 };
+	Range winCon = { 0.1, 0.5 };
+	Range restitution = { 0.5, 0.5 };
+	Range fuel = { 20, 250 };
+	Range thrust = { 5, 5 };
+	Range descent = { 0.05, 0.3 };
+};
+
+//  one episode: its parameters and what happened
+//
+class Episode {
+public:
+	uint64_t seed = 0;
+	Vector3 start;
+	float winCon = 0, restitution = 0, thrust = 0, descent = 0;
+	int fuel = 0;
+
+	LanderEvent outcome = LanderNone;   // LanderNone = step limit reached
+	int ticks = 0;
+	int fuelLeft = 0;
+	float speed = 0;                    // vertical speed at the end
+};
+
+//  vertices and faces of a Wavefront .obj (polygons split into fans)
+//
+static bool loadObj(const std::string & path, std::vector<Vector3> & verts, std::vector<int> & indices) {
+	std::ifstream in(path);
+	if (!in) return false;
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream s(line);
+		std::string tag;
+		s >> tag;
+		if (tag == "v") {
+			float x, y, z;
+			s >> x >> y >> z;
+			verts.push_back(Vector3(x, y, z));
+		}
+		else if (tag == "f") {
+			std::vector<int> poly;
+			std::string corner;
+			while (s >> corner) {
+				int i = atoi(corner.c_str());             // "v", "v/t", "v/t/n" or "v//n"
+				poly.push_back(i < 0 ? verts.size() + i : i - 1);
+			}
+			for (size_t k = 2; k < poly.size(); k++) {
+				indices.push_back(poly[0]);
+				indices.push_back(poly[k - 1]);
+				indices.push_back(poly[k]);
+			}
+		}
+	}
+	return !verts.empty();
+}
+
+//  fly one episode with a simple autopilot: fire the up thruster whenever
+//  the lander falls faster than the target descent rate
+//
+static void runEpisode(const OctreeCore & terrain, const OctreeCore * surface, const Heightfield * ground,
+	const SweepSettings & set, int index, Episode & ep) {
+	Rng pick(set.seed + index * 0x9e3779b97f4a7c15ULL);
+	ep.seed = pick.next();
+	Rng rng(ep.seed);
+	ep.start = Vector3(set.x.draw(rng), set.y.draw(rng), set.z.draw(rng));
+	ep.winCon = set.winCon.draw(rng);
+	ep.restitution = set.restitution.draw(rng);
+	ep.fuel = (int)set.fuel.draw(rng);
+	ep.thrust = set.thrust.draw(rng);
+	ep.descent = set.descent.draw(rng);
+
+	LanderSim sim;
+	float h = set.size / 2;
+	sim.bounds = Box(Vector3(-h, 0, -h), Vector3(h, set.size, h));
+	sim.startingPosition = ep.start;
+	sim.winCon = ep.winCon;
+	sim.restitution = ep.restitution;
+	sim.startFuel = ep.fuel;
+	sim.thrust = ep.thrust;
+	sim.integrator = set.integrator;
+	sim.setTerrain(&terrain, surface, ground);
+	sim.reset(rng.next());
+
+	LanderEvent event = LanderNone;
+	for (int i = 0; i < set.maxSteps && event == LanderNone; i++) {
+		if (sim.velocity.y() < -ep.descent) sim.apply(ThrustUp);
+		event = sim.step(set.dt);
+	}
+	ep.outcome = event;
+	ep.ticks = sim.tick;
+	ep.fuelLeft = sim.fuel;
+	ep.speed = sim.velocity.y();
+}
+
+static const char *outcomeName(LanderEvent e) {
+	switch (e) {
+	case LanderLanded: return "landed";
+	case LanderCrashed: return "crashed";
+	case LanderOutOfFuel: return "out_of_fuel";
+	default: return "timeout";
+	}
+}
+
+static bool writeCsv(const std::string & path, const std::vector<Episode> & eps) {
+	FILE *f = fopen(path.c_str(), "w");
+	if (f == NULL) return false;
+	fprintf(f, "episode,seed,x,y,z,wincon,restitution,fuel,thrust,descent,outcome,ticks,fuel_left,speed\n");
+	int numEpisodes = eps.size();
+	for (int i = 0; i < numEpisodes; i++) {
+		const Episode &e = eps[i];
+		fprintf(f, "%d,%llu,%g,%g,%g,%g,%g,%d,%g,%g,%s,%d,%d,%g\n", i, (unsigned long long)e.seed,
+			e.start.x(), e.start.y(), e.start.z(), e.winCon, e.restitution, e.fuel, e.thrust, e.descent,
+			outcomeName(e.outcome), e.ticks, e.fuelLeft, e.speed);
+	}
+	fclose(f);
+	return true;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: landerSweep model.obj [-episodes n] [-threads n] [-seed s] [-out file.csv]\n"
+		"    [-levels n] [-flat] [-steps n] [-dt sec] [-integrator euler|symplectic|verlet|rk4] [-size s]\n"
+		"    [-x lo hi] [-y lo hi] [-z lo hi] [-wincon lo hi] [-restitution lo hi]\n"
+		"    [-fuel lo hi] [-thrust lo hi] [-descent lo hi]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) usage();
+	std::string model = argv[1];
+	SweepSettings set;
+
+	struct { const char *name; Range *range; } ranges[] = {
+		{ "-x", &set.x }, { "-y", &set.y }, { "-z", &set.z }, { "-wincon", &set.winCon },
+		{ "-restitution", &set.restitution }, { "-fuel", &set.fuel }, { "-thrust", &set.thrust },
+		{ "-descent", &set.descent }
+	};
+	for (int i = 2; i < argc; i++) {
+		std::string opt = argv[i];
+		if (opt == "-flat") {
+			set.flat = true;
+			continue;
+		}
+		bool more = i + 1 < argc;
+		bool found = false;
+		for (auto & r : ranges) {
+			if (opt == r.name) {
+				if (i + 2 >= argc) usage();
+				r.range->lo = atof(argv[++i]);
+				r.range->hi = atof(argv[++i]);
+				found = true;
+			}
+		}
+		if (found) continue;
+		if (!more) usage();
+		const char *val = argv[++i];
+		if (opt == "-episodes") set.episodes = atoi(val);
+		else if (opt == "-threads") set.threads = atoi(val);
+		else if (opt == "-seed") set.seed = strtoull(val, NULL, 10);
+		else if (opt == "-out") set.out = val;
+		else if (opt == "-levels") set.levels = atoi(val);
+		else if (opt == "-steps") set.maxSteps = atoi(val);
+		else if (opt == "-dt") set.dt = atof(val);
+		else if (opt == "-size") set.size = atof(val);
+		else if (opt == "-integrator") {
+			std::string name = val;
+			if (name == "euler") set.integrator = ExplicitEuler;
+			else if (name == "symplectic") set.integrator = SemiImplicitEuler;
+			else if (name == "verlet") set.integrator = VelocityVerlet;
+			else if (name == "rk4") set.integrator = RungeKutta4;
+			else usage();
+		}
+		else usage();
+	}
+
+	// terrain: point octree for contact, built once (or mapped from the
+	// cache) and shared by every episode
+	//
+	std::vector<Vector3> verts;
+	std::vector<int> indices;
+	if (!loadObj(model, verts, indices)) {
+		fprintf(stderr, "Unable to read model %s\n", model.c_str());
+		return 1;
+	}
+	std::string cachePath = model.substr(0, model.rfind('.')) + "-sweep.octree";
+	OctreeCore terrain;
+	terrain.bParallel = true;
+	double t0 = now();
+	bool cached = terrain.createCached(verts, indices, set.levels, cachePath);
+	double t1 = now();
+	printf("terrain: %d verts, %d nodes, %.1f ms%s\n", (int)verts.size(), terrain.numNodes,
+		(t1 - t0) * 1000, cached ? " (cached)" : "");
+
+	// face octree of the surface for contact (as the app's terrain octree)
+	// and its height grid
+	//
+	OctreeCore faces;
+	Heightfield heights;
+	if (!set.flat) {
+		faces.bUseFaces = true;
+		faces.bParallel = true;
+		t0 = now();
+		cached = faces.createCached(verts, indices, 12, model.substr(0, model.rfind('.')) + "-sweep-faces.octree");
+		t1 = now();
+		printf("surface: %d faces, %d nodes, %.1f ms%s\n", faces.numFaces, faces.numNodes,
+			(t1 - t0) * 1000, cached ? " (cached)" : "");
+		t0 = now();
+		heights.create(&faces);
+		t1 = now();
+		printf("height grid: %d x %d, %.1f ms\n", heights.numX, heights.numZ, (t1 - t0) * 1000);
+	}
+	const OctreeCore *surface = set.flat ? NULL : &faces;
+	const Heightfield *ground = set.flat ? NULL : &heights;
+
+	// episodes in blocks spread over the pool; the caller works too, so
+	// n threads = a pool of n - 1
+	//
+	ThreadPool *pool = &ThreadPool::shared();
+	ThreadPool *own = NULL;
+	if (set.threads > 0) pool = own = new ThreadPool(set.threads - 1);
+
+	std::vector<Episode> eps(set.episodes);
+	const int block = 16;
+	TaskGroup group;
+	double t2 = now();
+	for (int b = 0; b < set.episodes; b += block) {
+		pool->submit(group, [&terrain, surface, ground, &set, &eps, b, block]() {
+			int end = std::min(b + block, set.episodes);
+			for (int i = b; i < end; i++)
+				runEpisode(terrain, surface, ground, set, i, eps[i]);
+		});
+	}
+	pool->wait(group);
+	double t3 = now();
+	int numThreads = pool->size() + 1;
+	delete own;
+
+	if (!writeCsv(set.out, eps)) {
+		fprintf(stderr, "Unable to write %s\n", set.out.c_str());
+		return 1;
+	}
+
+	// summary
+	//
+	int count[4] = { 0, 0, 0, 0 };
+	double fuelLanded = 0, ticks = 0;
+	for (size_t i = 0; i < eps.size(); i++) {
+		count[eps[i].outcome]++;
+		ticks += eps[i].ticks;
+		if (eps[i].outcome == LanderLanded) fuelLanded += eps[i].fuelLeft;
+	}
+	int n = set.episodes > 0 ? set.episodes : 1;
+	printf("episodes %d on %d threads: %.3f sec, %.0f episodes/sec, %.3g steps/sec\n", set.episodes,
+		numThreads, t3 - t2, set.episodes / (t3 - t2), ticks / (t3 - t2));
+	printf("landed %.1f%%  crashed %.1f%%  out of fuel %.1f%%  timeout %.1f%%\n",
+		100.0 * count[LanderLanded] / n, 100.0 * count[LanderCrashed] / n,
+		100.0 * count[LanderOutOfFuel] / n, 100.0 * count[LanderNone] / n);
+	printf("mean fuel left on landing %.1f, mean ticks %.0f\n",
+		count[LanderLanded] ? fuelLanded / count[LanderLanded] : 0.0, ticks / n);
+	printf("wrote %s\n", set.out.c_str());
+	return 0;
+}